@@ -0,0 +1,59 @@
+#pragma once
+
+#include "document.h"
+#include "thread_pool.h"
+
+#include <exception>
+#include <future>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Runs the queries of a server on a ThreadPool, so a front end keeps many requests in
+// flight without a thread of its own for each. Server is SearchServer, which must not
+// change while queries run, ConcurrentSearchServer or QueryResultCache. Queries are
+// copied, the caller's string may go away right after the call.
+template <typename Server>
+class AsyncSearchServer {
+public:
+	AsyncSearchServer(Server& server, ThreadPool& thread_pool);
+
+	std::future<std::vector<Document>> FindTopDocuments(std::string raw_query, DocumentStatus status = DocumentStatus::ACTUAL);
+
+	// Calls callback(documents, error) on the pool thread that ran the query; error is
+	// null unless the query threw, then documents are empty. Nothing waits for the result.
+	template <typename Callback>
+	void FindTopDocuments(std::string raw_query, DocumentStatus status, Callback callback);
+
+private:
+	Server& server_;
+	ThreadPool& thread_pool_;
+};
+
+template <typename Server>
+AsyncSearchServer<Server>::AsyncSearchServer(Server& server, ThreadPool& thread_pool)
+	: server_(server), thread_pool_(thread_pool) {
+}
+
+template <typename Server>
+std::future<std::vector<Document>> AsyncSearchServer<Server>::FindTopDocuments(std::string raw_query, DocumentStatus status) {
+	return thread_pool_.Submit([this, raw_query = std::move(raw_query), status] {
+		return server_.FindTopDocuments(raw_query, status);
+	});
+}
+
+template <typename Server>
+template <typename Callback>
+void AsyncSearchServer<Server>::FindTopDocuments(std::string raw_query, DocumentStatus status, Callback callback) {
+	thread_pool_.Submit([this, raw_query = std::move(raw_query), status, callback = std::move(callback)]() mutable {
+		std::vector<Document> documents;
+		std::exception_ptr error;
+		try {
+			documents = server_.FindTopDocuments(raw_query, status);
+		}
+		catch (...) {
+			error = std::current_exception();
+		}
+		callback(std::move(documents), error);
+	});
+}
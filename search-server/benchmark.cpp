@@ -0,0 +1,237 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <iomanip>
+#include <istream>
+#include <stdexcept>
+#include <thread>
+
+using namespace std::string_literals;
+
+BenchmarkRun::BenchmarkRun(size_t iterations)
+	: iterations_(iterations) {
+}
+
+size_t BenchmarkRun::GetIterations() const {
+	return iterations_;
+}
+
+void BenchmarkRun::StartTiming() {
+	if (!is_timing_) {
+		is_timing_ = true;
+		start_time_ = Clock::now();
+	}
+}
+
+void BenchmarkRun::StopTiming() {
+	if (is_timing_) {
+		elapsed_ += Clock::now() - start_time_;
+		is_timing_ = false;
+	}
+}
+
+std::chrono::nanoseconds BenchmarkRun::GetElapsed() const {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed_);
+}
+
+namespace {
+
+std::chrono::nanoseconds RunSample(const BenchmarkCase& benchmark_case, size_t iterations) {
+	BenchmarkRun run(iterations);
+	benchmark_case.function(run);
+	run.StopTiming();
+	return run.GetElapsed();
+}
+
+// value at fractional position in sorted values
+double GetQuantile(const std::vector<double>& sorted_values, double position) {
+	const size_t lower = static_cast<size_t>(std::floor(position));
+	const size_t upper = std::min(lower + 1, sorted_values.size() - 1);
+	const double weight = position - lower;
+	return sorted_values[lower] * (1.0 - weight) + sorted_values[upper] * weight;
+}
+
+void ComputeStatistics(BenchmarkResult& result) {
+	std::vector<double> sorted = result.sample_ns;
+	std::sort(sorted.begin(), sorted.end());
+	const size_t n = sorted.size();
+	result.median_ns = GetQuantile(sorted, (n - 1) / 2.0);
+	result.min_ns = sorted.front();
+	result.max_ns = sorted.back();
+
+	double sum = 0.0;
+	for (const double value : sorted) {
+		sum += value;
+	}
+	result.mean_ns = sum / n;
+	double square_sum = 0.0;
+	for (const double value : sorted) {
+		square_sum += (value - result.mean_ns) * (value - result.mean_ns);
+	}
+	result.stddev_ns = n > 1 ? std::sqrt(square_sum / (n - 1)) : 0.0;
+
+	std::vector<double> deviations;
+	for (const double value : sorted) {
+		deviations.push_back(std::abs(value - result.median_ns));
+	}
+	std::sort(deviations.begin(), deviations.end());
+	result.mad_ns = GetQuantile(deviations, (n - 1) / 2.0);
+
+	// the median lies between the order statistics n/2 -+ 1.96 sqrt(n)/2 with 95% probability
+	const double half_width = 1.96 * std::sqrt(static_cast<double>(n)) / 2.0;
+	const double low_rank = std::max(1.0, std::floor(n / 2.0 - half_width));
+	const double high_rank = std::min(static_cast<double>(n), std::ceil(n / 2.0 + half_width) + 1.0);
+	result.ci_low_ns = sorted[static_cast<size_t>(low_rank) - 1];
+	result.ci_high_ns = sorted[static_cast<size_t>(high_rank) - 1];
+
+	if (result.median_ns > 0.0) {
+		result.items_per_second = result.items_per_iteration * 1e9 / result.median_ns;
+	}
+}
+
+// the names and values are ours, only quotes and backslashes need escaping
+std::string Quote(const std::string& text) {
+	std::string result = "\""s;
+	for (const char c : text) {
+		if (c == '"' || c == '\\') {
+			result.push_back('\\');
+		}
+		result.push_back(c);
+	}
+	result.push_back('"');
+	return result;
+}
+
+std::string ReadString(const std::string& line, const std::string& key) {
+	const std::string pattern = Quote(key) + ": \""s;
+	size_t pos = line.find(pattern);
+	if (pos == std::string::npos) {
+		throw std::invalid_argument("Baseline result has no "s + key);
+	}
+	std::string result;
+	for (pos += pattern.size(); pos < line.size() && line[pos] != '"'; ++pos) {
+		if (line[pos] == '\\') {
+			++pos;
+		}
+		result.push_back(line[pos]);
+	}
+	return result;
+}
+
+double ReadNumber(const std::string& line, const std::string& key) {
+	const std::string pattern = Quote(key) + ": "s;
+	const size_t pos = line.find(pattern);
+	if (pos == std::string::npos) {
+		throw std::invalid_argument("Baseline result has no "s + key);
+	}
+	return std::stod(line.substr(pos + pattern.size()));
+}
+
+}  // namespace
+
+BenchmarkResult RunBenchmark(const BenchmarkCase& benchmark_case, const BenchmarkOptions& options) {
+	for (size_t i = 0; i < options.warmup_count; ++i) {
+		RunSample(benchmark_case, 1);
+	}
+	const std::chrono::nanoseconds calibration = std::max(RunSample(benchmark_case, 1), std::chrono::nanoseconds(1));
+	const size_t iterations = std::clamp<size_t>(
+		static_cast<size_t>(std::chrono::nanoseconds(options.min_sample_time) / calibration), 1, benchmark_case.max_iterations);
+
+	BenchmarkResult result;
+	result.name = benchmark_case.name;
+	result.params = benchmark_case.params;
+	result.iterations_per_sample = iterations;
+	result.items_per_iteration = benchmark_case.items_per_iteration;
+	for (size_t i = 0; i < std::max<size_t>(options.sample_count, 1); ++i) {
+		result.sample_ns.push_back(static_cast<double>(RunSample(benchmark_case, iterations).count()) / iterations);
+	}
+	ComputeStatistics(result);
+	return result;
+}
+
+void WriteBenchmarkJson(std::ostream& output, const std::vector<BenchmarkResult>& results, const BenchmarkOptions& options) {
+	const std::time_t now = std::time(nullptr);
+	char date[32];
+	std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+#ifdef NDEBUG
+	const bool is_optimized = true;
+#else
+	const bool is_optimized = false;
+#endif
+
+	output << std::setprecision(10);
+	output << "{\n"s;
+	output << "  \"context\": {\"date\": "s << Quote(date) << ", \"compiler\": "s << Quote(__VERSION__)
+		<< ", \"ndebug\": "s << (is_optimized ? "true"s : "false"s)
+		<< ", \"hardware_concurrency\": "s << std::thread::hardware_concurrency()
+		<< ", \"sample_count\": "s << options.sample_count
+		<< ", \"min_sample_time_ms\": "s << options.min_sample_time.count() << "},\n"s;
+	output << "  \"benchmarks\": [\n"s;
+	for (size_t i = 0; i < results.size(); ++i) {
+		const BenchmarkResult& result = results[i];
+		output << "    {\"name\": "s << Quote(result.name) << ", \"params\": {"s;
+		for (size_t j = 0; j < result.params.size(); ++j) {
+			output << (j > 0 ? ", "s : ""s) << Quote(result.params[j].first) << ": "s << Quote(result.params[j].second);
+		}
+		output << "}, \"iterations_per_sample\": "s << result.iterations_per_sample
+			<< ", \"items_per_iteration\": "s << result.items_per_iteration
+			<< ", \"median_ns\": "s << result.median_ns
+			<< ", \"ci_low_ns\": "s << result.ci_low_ns
+			<< ", \"ci_high_ns\": "s << result.ci_high_ns
+			<< ", \"mean_ns\": "s << result.mean_ns
+			<< ", \"stddev_ns\": "s << result.stddev_ns
+			<< ", \"min_ns\": "s << result.min_ns
+			<< ", \"max_ns\": "s << result.max_ns
+			<< ", \"mad_ns\": "s << result.mad_ns
+			<< ", \"items_per_second\": "s << result.items_per_second
+			<< ", \"samples_ns\": ["s;
+		for (size_t j = 0; j < result.sample_ns.size(); ++j) {
+			output << (j > 0 ? ", "s : ""s) << result.sample_ns[j];
+		}
+		output << "]}"s << (i + 1 < results.size() ? ","s : ""s) << "\n"s;
+	}
+	output << "  ]\n"s;
+	output << "}\n"s;
+}
+
+std::map<std::string, BenchmarkResult> ReadBenchmarkBaseline(std::istream& input) {
+	std::map<std::string, BenchmarkResult> baseline;
+	std::string line;
+	while (std::getline(input, line)) {
+		if (line.find("\"median_ns\""s) == std::string::npos) {
+			continue;
+		}
+		BenchmarkResult result;
+		result.name = ReadString(line, "name"s);
+		result.median_ns = ReadNumber(line, "median_ns"s);
+		result.ci_low_ns = ReadNumber(line, "ci_low_ns"s);
+		result.ci_high_ns = ReadNumber(line, "ci_high_ns"s);
+		baseline[result.name] = std::move(result);
+	}
+	return baseline;
+}
+
+std::vector<BenchmarkComparison> CompareWithBaseline(const std::vector<BenchmarkResult>& results,
+	const std::map<std::string, BenchmarkResult>& baseline, double threshold) {
+	std::vector<BenchmarkComparison> comparisons;
+	for (const BenchmarkResult& result : results) {
+		BenchmarkComparison comparison;
+		comparison.name = result.name;
+		const auto it = baseline.find(result.name);
+		if (it != baseline.end() && it->second.median_ns > 0.0) {
+			const BenchmarkResult& base = it->second;
+			comparison.change = result.median_ns / base.median_ns - 1.0;
+			comparison.verdict = BenchmarkVerdict::SAME;
+			if (comparison.change > threshold && result.ci_low_ns > base.ci_high_ns) {
+				comparison.verdict = BenchmarkVerdict::SLOWER;
+			}
+			else if (comparison.change < -threshold && result.ci_high_ns < base.ci_low_ns) {
+				comparison.verdict = BenchmarkVerdict::FASTER;
+			}
+		}
+		comparisons.push_back(comparison);
+	}
+	return comparisons;
+}
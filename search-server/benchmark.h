@@ -0,0 +1,102 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// One sample of a benchmark: the case runs its operation GetIterations() times and
+// times only the part between StartTiming and StopTiming, which it may do many times,
+// so the setup of every iteration stays out of the measurement.
+class BenchmarkRun {
+public:
+	explicit BenchmarkRun(size_t iterations);
+
+	size_t GetIterations() const;
+
+	void StartTiming();
+
+	void StopTiming();
+
+	std::chrono::nanoseconds GetElapsed() const;
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	const size_t iterations_;
+	Clock::duration elapsed_{ 0 };
+	Clock::time_point start_time_;
+	bool is_timing_ = false;
+};
+
+struct BenchmarkCase {
+	// Operation/variant/parameter=value/..., the key of the baseline comparison
+	std::string name;
+	std::vector<std::pair<std::string, std::string>> params;
+	// items one iteration processes, such as the queries of a batch
+	size_t items_per_iteration = 1;
+	// iterations a sample may have, such as the documents there are to remove
+	size_t max_iterations = 1'000'000;
+	std::function<void(BenchmarkRun&)> function;
+};
+
+struct BenchmarkOptions {
+	size_t sample_count = 15;
+	size_t warmup_count = 1;
+	// a sample runs as many iterations as fit this time, after a calibration run
+	std::chrono::milliseconds min_sample_time{ 20 };
+};
+
+// Times of one iteration over the samples, in nanoseconds. The 95% confidence interval
+// of the median comes from the order statistics of the samples, so it makes no
+// assumption about their distribution.
+struct BenchmarkResult {
+	std::string name;
+	std::vector<std::pair<std::string, std::string>> params;
+	size_t iterations_per_sample = 0;
+	size_t items_per_iteration = 1;
+	std::vector<double> sample_ns;
+	double median_ns = 0.0;
+	double ci_low_ns = 0.0;
+	double ci_high_ns = 0.0;
+	double mean_ns = 0.0;
+	double stddev_ns = 0.0;
+	double min_ns = 0.0;
+	double max_ns = 0.0;
+	// median absolute deviation from the median
+	double mad_ns = 0.0;
+	double items_per_second = 0.0;
+};
+
+BenchmarkResult RunBenchmark(const BenchmarkCase& benchmark_case, const BenchmarkOptions& options);
+
+// results with the machine and the build they ran on
+void WriteBenchmarkJson(std::ostream& output, const std::vector<BenchmarkResult>& results, const BenchmarkOptions& options);
+
+// Reads what WriteBenchmarkJson wrote: every result on a line of its own. Only the
+// fields the comparison needs are read.
+std::map<std::string, BenchmarkResult> ReadBenchmarkBaseline(std::istream& input);
+
+enum class BenchmarkVerdict {
+	SAME,
+	FASTER,
+	SLOWER,
+	// not in the baseline
+	NEW,
+};
+
+struct BenchmarkComparison {
+	std::string name;
+	BenchmarkVerdict verdict = BenchmarkVerdict::NEW;
+	// relative change of the median, 0.1 is 10% slower
+	double change = 0.0;
+};
+
+// A result is faster or slower only when its median moved by more than threshold and
+// the confidence intervals of the two medians do not overlap.
+std::vector<BenchmarkComparison> CompareWithBaseline(const std::vector<BenchmarkResult>& results,
+	const std::map<std::string, BenchmarkResult>& baseline, double threshold);
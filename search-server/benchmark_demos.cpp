@@ -0,0 +1,454 @@
+#include "benchmark_demos.h"
+
+#include "async_search_server.h"
+#include "concurrent_search_server.h"
+#include "corpus_generator.h"
+#include "index_snapshot.h"
+#include "log_duration.h"
+#include "process_queries.h"
+#include "query_result_cache.h"
+#include "request_queue.h"
+#include "search_server.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <execution>
+#include <future>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+template <typename ExecutionPolicy>
+void Test(string_view mark, const SearchServer& search_server, const vector<string>& queries, ExecutionPolicy&& policy) {
+    LOG_DURATION_COUNTERS(mark);
+    double total_relevance = 0;
+    for (const string_view query : queries) {
+        for (const auto& document : search_server.FindTopDocuments(policy, query)) {
+            total_relevance += document.relevance;
+        }
+    }
+    cout << total_relevance << endl;
+}
+
+#define TEST(policy) Test(#policy, search_server, queries, execution::policy)
+
+
+template <typename ExecutionPolicy>
+void Test1(string_view mark, SearchServer search_server, const string& query, ExecutionPolicy&& policy) {
+    LOG_DURATION_COUNTERS(mark);
+    const int document_count = search_server.GetDocumentCount();
+    int word_count = 0;
+    for (int id = 0; id < document_count; ++id) {
+        const auto [words, status] = search_server.MatchDocument(policy, query, id);
+        word_count += words.size();
+    }
+    cout << word_count << endl;
+}
+
+#define TEST1(policy) Test1(#policy, search_server, query, execution::policy)
+
+// worst latency of queries issued while another thread adds the batches
+template <typename Find, typename Add>
+void TestReadLatency(string_view mark, const vector<string>& queries, const vector<vector<NewDocument>>& batches, Find find, Add add) {
+    atomic<bool> is_writing = true;
+    thread writer([&] {
+        for (const auto& batch : batches) {
+            add(batch);
+        }
+        is_writing = false;
+    });
+    chrono::steady_clock::duration max_latency{};
+    size_t query_count = 0;
+    while (is_writing) {
+        const auto start = chrono::steady_clock::now();
+        find(queries[query_count++ % queries.size()]);
+        max_latency = max(max_latency, chrono::steady_clock::now() - start);
+    }
+    writer.join();
+    cout << mark << ": "s << query_count << " queries, max latency "s
+        << chrono::duration_cast<chrono::milliseconds>(max_latency).count() << " ms"s << endl;
+}
+
+}  // namespace
+
+void RunDemos() {
+    {
+        mt19937 generator;
+    
+        const auto dictionary = GenerateDictionary(generator, 1000, 10);
+        const auto documents = GenerateQueries(generator, dictionary, 10'000, 70);
+    
+        SearchServer search_server(dictionary[0]);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+        }
+    
+        const auto queries = GenerateQueries(generator, dictionary, 100, 70);
+    
+        TEST(seq);
+        TEST(par);
+        {
+            RequestQueue request_queue(search_server, 1min);
+            {
+                LOG_DURATION("seq through RequestQueue"s);
+                for (const string& query : queries) {
+                    request_queue.AddFindRequest(query);
+                }
+            }
+            const QueryTelemetryStats stats = request_queue.GetStats();
+            cout << stats.request_count << " requests, "s << stats.no_result_rate * 100 << "% without results, latency p50 "s
+                << stats.p50.count() / 1000 << " us, p99 "s << stats.p99.count() / 1000 << " us, p999 "s
+                << stats.p999.count() / 1000 << " us"s << endl;
+        }
+#ifdef SEARCH_SERVER_PROFILE
+        {
+            // phases of the exhaustive searches above, over every thread
+            const SearchProfileStats profile = search_server.GetProfile();
+            const pair<SearchPhase, string> phases[] = {
+                { SearchPhase::PARSE, "parse"s }, { SearchPhase::STOP_WORDS, "stop words"s },
+                { SearchPhase::POSTINGS, "postings"s }, { SearchPhase::MINUS_WORDS, "minus words"s },
+                { SearchPhase::MATERIALIZE, "materialize"s }, { SearchPhase::SORT, "sort"s },
+            };
+            for (const auto& [phase, name] : phases) {
+                cout << name << ": "s << profile[phase].calls << " calls, "s << profile[phase].duration.count() / 1000 << " us"s << endl;
+            }
+            cout << profile.postings_scanned << " postings scanned, "s << profile.documents_scored << " documents scored"s << endl;
+            search_server.ResetProfile();
+        }
+#endif
+
+        search_server.SetRankingMode(RankingMode::DYNAMIC_PRUNING);
+        Test("dynamic pruning"s, search_server, queries, execution::seq);
+
+        search_server.SetRankingMode(RankingMode::IMPACT_ORDERED);
+        Test("impact ordered, building impacts"s, search_server, queries, execution::seq);
+        Test("impact ordered"s, search_server, queries, execution::seq);
+        {
+            // accuracy against exact TF-IDF scoring
+            size_t identical_count = 0;
+            size_t found_count = 0;
+            size_t expected_count = 0;
+            for (const string& query : queries) {
+                search_server.SetRankingMode(RankingMode::EXHAUSTIVE);
+                const auto expected = search_server.FindTopDocuments(query);
+                search_server.SetRankingMode(RankingMode::IMPACT_ORDERED);
+                const auto found = search_server.FindTopDocuments(query);
+                bool is_identical = expected.size() == found.size();
+                for (const Document& document : expected) {
+                    const bool is_found = any_of(found.begin(), found.end(), [&document](const Document& other) {
+                        return other.id == document.id;
+                    });
+                    found_count += is_found;
+                    is_identical = is_identical && is_found;
+                }
+                expected_count += expected.size();
+                identical_count += is_identical;
+            }
+            cout << "impact ordered accuracy: "s << identical_count << " of "s << queries.size()
+                << " results identical, recall "s << found_count * 1.0 / expected_count << endl;
+        }
+
+        const PostingMemoryUsage segmented_usage = search_server.GetPostingMemoryUsage();
+        search_server.CompressPostings();
+        const PostingMemoryUsage compressed_usage = search_server.GetPostingMemoryUsage();
+        cout << "bytes per posting: "s << segmented_usage.bytes * 1.0 / segmented_usage.posting_count
+            << " segmented, "s << compressed_usage.bytes * 1.0 / compressed_usage.posting_count << " compressed"s << endl;
+        search_server.SetRankingMode(RankingMode::DYNAMIC_PRUNING);
+        Test("compressed dynamic pruning"s, search_server, queries, execution::seq);
+        search_server.SetRankingMode(RankingMode::EXHAUSTIVE);
+        {
+            // a query of hundreds of words must still answer within its budget
+            string long_query = dictionary[1];
+            for (size_t i = 2; i < 300; ++i) {
+                long_query += " "s + dictionary[i];
+            }
+            for (const auto budget : { 1ms, 100ms }) {
+                SearchLimits limits;
+                limits.deadline = chrono::steady_clock::now() + budget;
+                LOG_DURATION("query of 299 words, "s + to_string(budget.count()) + " ms budget"s);
+                const SearchResult result = search_server.FindTopDocuments(long_query, DocumentStatus::ACTUAL, limits);
+                cout << result.documents.size() << " documents"s << (result.is_partial ? ", partial"s : ""s) << endl;
+            }
+        }
+        Test("compressed seq"s, search_server, queries, execution::seq);
+        Test("compressed par"s, search_server, queries, execution::par);
+
+        {
+            // skewed traffic: a few of the queries make up most of the requests
+            geometric_distribution<size_t> query_index(0.05);
+            vector<string_view> requests;
+            for (int i = 0; i < 1'000; ++i) {
+                requests.push_back(queries[min(query_index(generator), queries.size() - 1)]);
+            }
+            const auto run = [&requests](auto find) {
+                double total_relevance = 0;
+                for (const string_view query : requests) {
+                    for (const auto& document : find(query)) {
+                        total_relevance += document.relevance;
+                    }
+                }
+                cout << total_relevance << endl;
+            };
+            {
+                LOG_DURATION("uncached"s);
+                run([&](string_view query) { return search_server.FindTopDocuments(query); });
+            }
+            QueryResultCache cache(search_server, 1 << 20);
+            {
+                LOG_DURATION("cached"s);
+                run([&](string_view query) { return cache.FindTopDocuments(query); });
+            }
+            const QueryCacheStats stats = cache.GetStats();
+            cout << "cache hits "s << stats.hits << ", misses "s << stats.misses << endl;
+        }
+
+        {
+            // a batch over a skewed vocabulary: popular words repeat across the queries
+            geometric_distribution<size_t> word_index(0.02);
+            vector<string> batch_queries;
+            for (int i = 0; i < 1'000; ++i) {
+                string query;
+                for (int j = 0; j < 5; ++j) {
+                    query += (j > 0 ? " "s : ""s) + dictionary[min(word_index(generator), dictionary.size() - 1)];
+                }
+                batch_queries.push_back(move(query));
+            }
+            const auto report = [](const vector<vector<Document>>& results) {
+                double total_relevance = 0;
+                for (const auto& documents : results) {
+                    for (const Document& document : documents) {
+                        total_relevance += document.relevance;
+                    }
+                }
+                cout << total_relevance << endl;
+            };
+            {
+                LOG_DURATION("batch one by one"s);
+                vector<vector<Document>> results;
+                for (const string& query : batch_queries) {
+                    results.push_back(search_server.FindTopDocuments(query));
+                }
+                report(results);
+            }
+            {
+                LOG_DURATION("batch with shared scans"s);
+                report(ProcessQueries(search_server, batch_queries));
+            }
+            {
+                LOG_DURATION("batch joined, streamed"s);
+                double total_relevance = 0;
+                ProcessQueriesJoined(search_server, batch_queries, [&total_relevance](const Document& document) {
+                    total_relevance += document.relevance;
+                });
+                cout << total_relevance << endl;
+            }
+            {
+                ThreadPool thread_pool;
+                AsyncSearchServer async_server(search_server, thread_pool);
+                LOG_DURATION("batch through the thread pool"s);
+                vector<future<vector<Document>>> results;
+                for (const string& query : batch_queries) {
+                    results.push_back(async_server.FindTopDocuments(query));
+                }
+                double total_relevance = 0;
+                for (auto& documents : results) {
+                    for (const Document& document : documents.get()) {
+                        total_relevance += document.relevance;
+                    }
+                }
+                cout << total_relevance << endl;
+            }
+        }
+
+        {
+            LOG_DURATION("save snapshot"s);
+            search_server.SaveSnapshot("search_server.idx"s);
+        }
+        {
+            optional<MappedSearchServer> mapped_server;
+            {
+                LOG_DURATION("open snapshot"s);
+                mapped_server.emplace("search_server.idx"s);
+            }
+            LOG_DURATION("mapped"s);
+            double total_relevance = 0;
+            for (const string_view query : queries) {
+                for (const auto& document : mapped_server->FindTopDocuments(query)) {
+                    total_relevance += document.relevance;
+                }
+            }
+            cout << total_relevance << endl;
+        }
+        remove("search_server.idx");
+    }
+
+    {
+        mt19937 generator;
+
+        const auto dictionary = GenerateDictionary(generator, 1000, 10);
+        const auto documents = GenerateQueries(generator, dictionary, 50'000, 70);
+        vector<NewDocument> batch;
+        for (size_t i = 0; i < documents.size(); ++i) {
+            batch.push_back({ static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 } });
+        }
+
+        {
+            SearchServer search_server(dictionary[0]);
+            LOG_DURATION("AddDocument loop"s);
+            for (const NewDocument& document : batch) {
+                search_server.AddDocument(document.id, document.text, document.status, document.ratings);
+            }
+        }
+        {
+            SearchServer search_server(dictionary[0]);
+            LOG_DURATION("AddDocuments seq"s);
+            search_server.AddDocuments(execution::seq, batch);
+            // a std::string per document would take a malloc block of its own:
+            // 8 bytes of header, rounded up to 16 bytes
+            size_t string_bytes = 0;
+            for (const string& document : documents) {
+                string_bytes += sizeof(string) + (document.size() > 15 ? (document.size() + 1 + 8 + 15) / 16 * 16 : 0);
+            }
+            const TextMemoryUsage usage = search_server.GetTextMemoryUsage();
+            cout << "document texts: "s << usage.document_bytes << " bytes in the arena, "s
+                << string_bytes << " bytes as strings; words: "s << usage.word_bytes << " bytes"s << endl;
+        }
+        {
+            SearchServer search_server(dictionary[0]);
+            LOG_DURATION("AddDocuments par"s);
+            search_server.AddDocuments(execution::par, batch);
+        }
+
+        vector<string> updated_texts;
+        for (size_t i = batch.size() - 2'000; i < batch.size(); ++i) {
+            // one word replaced, the length of the document stays the same
+            const size_t first_space = documents[i].find(' ');
+            updated_texts.push_back(dictionary[i % dictionary.size()]
+                + (first_space == string::npos ? ""s : documents[i].substr(first_space)));
+        }
+        {
+            SearchServer search_server(dictionary[0]);
+            search_server.AddDocuments(batch);
+            LOG_DURATION("RemoveDocument and AddDocument"s);
+            for (size_t i = 0; i < updated_texts.size(); ++i) {
+                const NewDocument& document = batch[batch.size() - updated_texts.size() + i];
+                search_server.RemoveDocument(document.id);
+                search_server.AddDocument(document.id, updated_texts[i], document.status, document.ratings);
+            }
+        }
+        {
+            SearchServer search_server(dictionary[0]);
+            search_server.AddDocuments(batch);
+            LOG_DURATION("UpdateDocument"s);
+            for (size_t i = 0; i < updated_texts.size(); ++i) {
+                const NewDocument& document = batch[batch.size() - updated_texts.size() + i];
+                search_server.UpdateDocument(document.id, updated_texts[i], document.status, document.ratings);
+            }
+        }
+
+        {
+            // lookups of every word of the documents, as ingestion and query parsing do them
+            const vector<string_view> stop_words(dictionary.begin(), dictionary.begin() + 100);
+            const set<string_view> stop_word_set(stop_words.begin(), stop_words.end());
+            const FrozenWordSet frozen_stop_words(stop_words);
+            TermDictionary terms;
+            for (const string& word : dictionary) {
+                terms.Intern(word);
+            }
+            const auto run = [&documents](string_view mark, auto contains) {
+                LOG_DURATION(mark);
+                size_t found_count = 0;
+                for (const string& document : documents) {
+                    ForEachWord(document, [&](string_view word, bool) {
+                        found_count += contains(word);
+                    });
+                }
+                cout << found_count << endl;
+            };
+            run("stop words in std::set"s, [&](string_view word) { return stop_word_set.count(word) > 0; });
+            run("stop words frozen"s, [&](string_view word) { return frozen_stop_words.Contains(word); });
+            // stop words known at build time are hashed by the compiler
+            constexpr auto STATIC_STOP_WORDS = MakeStaticWordSet("a", "an", "and", "in", "of", "on", "the", "with");
+            run("stop words hashed at compile time"s, [&](string_view word) { return STATIC_STOP_WORDS.Contains(word); });
+            run("terms in std::unordered_map"s, [&](string_view word) { return terms.Find(word) != TermDictionary::NO_TERM; });
+            terms.Freeze();
+            run("terms frozen"s, [&](string_view word) { return terms.Find(word) != TermDictionary::NO_TERM; });
+        }
+
+        {
+            // a server takes the static set in place of a string of stop words
+            constexpr auto STOP_WORDS = MakeStaticWordSet("a", "an", "and", "in", "of", "on", "the", "with");
+            SearchServer static_server(STOP_WORDS);
+            SearchServer string_server("a an and in of on the with"s);
+            for (size_t i = 0; i < 10'000; ++i) {
+                static_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+                string_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+            }
+            size_t same_count = 0;
+            for (const string& query : GenerateQueries(generator, dictionary, 100, 10)) {
+                const auto static_documents = static_server.FindTopDocuments(query);
+                const auto string_documents = string_server.FindTopDocuments(query);
+                same_count += equal(static_documents.begin(), static_documents.end(), string_documents.begin(), string_documents.end(),
+                    [](const Document& lhs, const Document& rhs) { return lhs.id == rhs.id && lhs.relevance == rhs.relevance; });
+            }
+            cout << same_count << " of 100 queries found the same with static stop words"s << endl;
+        }
+
+        vector<vector<NewDocument>> batches;
+        for (size_t i = 0; i < batch.size(); i += 5'000) {
+            batches.emplace_back(batch.begin() + i, batch.begin() + min(batch.size(), i + 5'000));
+        }
+        const auto queries = GenerateQueries(generator, dictionary, 100, 10);
+        {
+            SearchServer search_server(dictionary[0]);
+            shared_mutex mutex;
+            TestReadLatency("reads under shared_mutex"s, queries, batches,
+                [&](string_view query) {
+                    shared_lock lock(mutex);
+                    return search_server.FindTopDocuments(query);
+                },
+                [&](const vector<NewDocument>& documents) {
+                    unique_lock lock(mutex);
+                    search_server.AddDocuments(documents);
+                });
+        }
+        {
+            ConcurrentSearchServer search_server(dictionary[0]);
+            TestReadLatency("reads of ConcurrentSearchServer"s, queries, batches,
+                [&](string_view query) {
+                    return search_server.FindTopDocuments(query);
+                },
+                [&](const vector<NewDocument>& documents) {
+                    search_server.AddDocuments(documents);
+                });
+        }
+    }
+
+    {
+        mt19937 generator;
+    
+        const auto dictionary = GenerateDictionary(generator, 1000, 10);
+        const auto documents = GenerateQueries(generator, dictionary, 10'000, 70);
+    
+        const string query = GenerateQuery(generator, dictionary, 500, 0.1);
+    
+        SearchServer search_server(dictionary[0]);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+        }
+    
+        TEST1(seq);
+        TEST1(par);
+    }
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+// Timed walkthroughs of the index features: every step prints its duration
+// and a summary of its results. Run by search_server_benchmark --demos.
+void RunDemos();
@@ -0,0 +1,479 @@
+#include "benchmark.h"
+#include "benchmark_demos.h"
+#include "corpus_generator.h"
+#include "process_queries.h"
+#include "remove_duplicates.h"
+#include "search_server.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <execution>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+using namespace std::literals;
+
+namespace {
+
+const uint32_t DEFAULT_SEED = 20240601;
+const int DOCUMENT_WORD_COUNT = 70;
+const int MAX_WORD_LENGTH = 10;
+const int QUERY_COUNT = 100;
+const int BATCH_QUERY_COUNT = 1000;
+// share of the documents of the RemoveDuplicates corpus that repeat the words of another
+const double DUPLICATE_SHARE = 0.1;
+
+struct CorpusConfig {
+	int document_count = 10'000;
+	int vocabulary_size = 1'000;
+	int query_word_count = 10;
+	double minus_prob = 0.0;
+};
+
+std::string FormatNumber(double value) {
+	std::ostringstream output;
+	output << value;
+	return output.str();
+}
+
+// The documents depend on the seed, the number of documents and the vocabulary only,
+// so every case of a sweep over the queries searches the same index.
+class Corpora {
+public:
+	explicit Corpora(uint32_t seed)
+		: seed_(seed) {
+	}
+
+	const std::vector<std::string>& GetDictionary(const CorpusConfig& config) {
+		return GetIndex(config).dictionary;
+	}
+
+	const SearchServer& GetServer(const CorpusConfig& config) {
+		return *GetIndex(config).server;
+	}
+
+	// the index with DUPLICATE_SHARE of its documents made duplicates of others
+	const SearchServer& GetServerWithDuplicates(const CorpusConfig& config) {
+		Index& index = GetIndex(config);
+		if (!index.server_with_duplicates) {
+			std::mt19937 generator(seed_ + 2);
+			std::vector<std::string> documents = index.documents;
+			for (size_t i = 1; i < documents.size(); ++i) {
+				if (std::uniform_real_distribution<>(0, 1)(generator) < DUPLICATE_SHARE) {
+					std::istringstream words(documents[std::uniform_int_distribution<size_t>(0, i - 1)(generator)]);
+					std::vector<std::string> shuffled{ std::istream_iterator<std::string>(words), std::istream_iterator<std::string>() };
+					std::shuffle(shuffled.begin(), shuffled.end(), generator);
+					documents[i].clear();
+					for (const std::string& word : shuffled) {
+						documents[i] += (documents[i].empty() ? ""s : " "s) + word;
+					}
+				}
+			}
+			index.server_with_duplicates = BuildServer(index.dictionary, documents);
+		}
+		return *index.server_with_duplicates;
+	}
+
+	const std::vector<std::string>& GetQueries(const CorpusConfig& config, int query_count) {
+		const auto key = std::make_tuple(config.document_count, config.vocabulary_size, config.query_word_count, config.minus_prob, query_count);
+		auto it = queries_.find(key);
+		if (it == queries_.end()) {
+			std::mt19937 generator(seed_ + 1);
+			it = queries_.emplace(key, GenerateQueries(generator, GetDictionary(config), query_count,
+				config.query_word_count, config.minus_prob)).first;
+		}
+		return it->second;
+	}
+
+	// documents that are not in the index, for AddDocument
+	const std::vector<std::string>& GetNewDocuments(const CorpusConfig& config, int document_count) {
+		Index& index = GetIndex(config);
+		if (index.new_documents.size() < static_cast<size_t>(document_count)) {
+			std::mt19937 generator(seed_ + 3);
+			index.new_documents = GenerateQueries(generator, index.dictionary, document_count, DOCUMENT_WORD_COUNT);
+		}
+		return index.new_documents;
+	}
+
+private:
+	struct Index {
+		std::vector<std::string> dictionary;
+		std::vector<std::string> documents;
+		std::unique_ptr<SearchServer> server;
+		std::unique_ptr<SearchServer> server_with_duplicates;
+		std::vector<std::string> new_documents;
+	};
+
+	const uint32_t seed_;
+	std::map<std::pair<int, int>, Index> indexes_;
+	std::map<std::tuple<int, int, int, double, int>, std::vector<std::string>> queries_;
+
+	static std::unique_ptr<SearchServer> BuildServer(const std::vector<std::string>& dictionary, const std::vector<std::string>& documents) {
+		auto server = std::make_unique<SearchServer>(dictionary[0]);
+		for (size_t i = 0; i < documents.size(); ++i) {
+			server->AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+		}
+		return server;
+	}
+
+	Index& GetIndex(const CorpusConfig& config) {
+		Index& index = indexes_[{ config.document_count, config.vocabulary_size }];
+		if (!index.server) {
+			std::mt19937 generator(seed_);
+			index.dictionary = GenerateDictionary(generator, config.vocabulary_size, MAX_WORD_LENGTH);
+			index.documents = GenerateQueries(generator, index.dictionary, config.document_count, DOCUMENT_WORD_COUNT);
+			index.server = BuildServer(index.dictionary, index.documents);
+		}
+		return index;
+	}
+};
+
+// parameters of the config the operation depends on, in the order of the name
+enum class ConfigParams { DOCUMENTS, DOCUMENTS_VOCABULARY, ALL };
+
+void SetNameAndParams(BenchmarkCase& benchmark_case, const std::string& operation, const CorpusConfig& config, ConfigParams params) {
+	benchmark_case.params = {
+		{ "documents"s, std::to_string(config.document_count) },
+		{ "vocabulary"s, std::to_string(config.vocabulary_size) },
+		{ "query_words"s, std::to_string(config.query_word_count) },
+		{ "minus_prob"s, FormatNumber(config.minus_prob) },
+	};
+	const size_t param_count = params == ConfigParams::DOCUMENTS ? 1 : params == ConfigParams::DOCUMENTS_VOCABULARY ? 2 : 4;
+	benchmark_case.params.resize(param_count);
+	benchmark_case.name = operation;
+	for (const auto& [key, value] : benchmark_case.params) {
+		benchmark_case.name += "/"s + key + "="s + value;
+	}
+}
+
+template <typename ExecutionPolicy>
+BenchmarkCase MakeFindTopDocuments(Corpora& corpora, const CorpusConfig& config, const std::string& policy_name, ExecutionPolicy policy) {
+	BenchmarkCase benchmark_case;
+	SetNameAndParams(benchmark_case, "FindTopDocuments/"s + policy_name, config, ConfigParams::ALL);
+	benchmark_case.function = [&corpora, config, policy](BenchmarkRun& run) {
+		const SearchServer& server = corpora.GetServer(config);
+		const auto& queries = corpora.GetQueries(config, QUERY_COUNT);
+		double total_relevance = 0.0;
+		run.StartTiming();
+		for (size_t i = 0; i < run.GetIterations(); ++i) {
+			for (const Document& document : server.FindTopDocuments(policy, queries[i % queries.size()])) {
+				total_relevance += document.relevance;
+			}
+		}
+		run.StopTiming();
+		// keeps the searches from being optimized away
+		if (total_relevance < 0) {
+			std::cerr << total_relevance;
+		}
+	};
+	return benchmark_case;
+}
+
+template <typename ExecutionPolicy>
+BenchmarkCase MakeMatchDocument(Corpora& corpora, const CorpusConfig& config, const std::string& policy_name, ExecutionPolicy policy) {
+	BenchmarkCase benchmark_case;
+	SetNameAndParams(benchmark_case, "MatchDocument/"s + policy_name, config, ConfigParams::ALL);
+	benchmark_case.function = [&corpora, config, policy](BenchmarkRun& run) {
+		const SearchServer& server = corpora.GetServer(config);
+		const auto& queries = corpora.GetQueries(config, QUERY_COUNT);
+		size_t word_count = 0;
+		run.StartTiming();
+		for (size_t i = 0; i < run.GetIterations(); ++i) {
+			const auto [words, status] = server.MatchDocument(policy, queries[i % queries.size()],
+				static_cast<int>(i % config.document_count));
+			word_count += words.size();
+		}
+		run.StopTiming();
+		if (word_count == SIZE_MAX) {
+			std::cerr << word_count;
+		}
+	};
+	return benchmark_case;
+}
+
+BenchmarkCase MakeAddDocument(Corpora& corpora, const CorpusConfig& config) {
+	BenchmarkCase benchmark_case;
+	SetNameAndParams(benchmark_case, "AddDocument"s, config, ConfigParams::DOCUMENTS_VOCABULARY);
+	benchmark_case.max_iterations = config.document_count;
+	benchmark_case.function = [&corpora, config](BenchmarkRun& run) {
+		const auto& documents = corpora.GetNewDocuments(config, config.document_count);
+		SearchServer server = corpora.GetServer(config);
+		run.StartTiming();
+		for (size_t i = 0; i < run.GetIterations(); ++i) {
+			server.AddDocument(config.document_count + static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+		}
+		run.StopTiming();
+	};
+	return benchmark_case;
+}
+
+BenchmarkCase MakeRemoveDocument(Corpora& corpora, const CorpusConfig& config) {
+	BenchmarkCase benchmark_case;
+	SetNameAndParams(benchmark_case, "RemoveDocument"s, config, ConfigParams::DOCUMENTS);
+	benchmark_case.max_iterations = config.document_count;
+	benchmark_case.function = [&corpora, config](BenchmarkRun& run) {
+		SearchServer server = corpora.GetServer(config);
+		run.StartTiming();
+		for (size_t i = 0; i < run.GetIterations(); ++i) {
+			server.RemoveDocument(static_cast<int>(i));
+		}
+		run.StopTiming();
+	};
+	return benchmark_case;
+}
+
+BenchmarkCase MakeRemoveDuplicates(Corpora& corpora, const CorpusConfig& config) {
+	BenchmarkCase benchmark_case;
+	SetNameAndParams(benchmark_case, "RemoveDuplicates"s, config, ConfigParams::DOCUMENTS);
+	benchmark_case.items_per_iteration = config.document_count;
+	benchmark_case.max_iterations = 8;
+	benchmark_case.function = [&corpora, config](BenchmarkRun& run) {
+		// RemoveDuplicates reports every duplicate on std::cout
+		std::ostringstream silenced;
+		std::streambuf* const cout_buffer = std::cout.rdbuf(silenced.rdbuf());
+		for (size_t i = 0; i < run.GetIterations(); ++i) {
+			SearchServer server = corpora.GetServerWithDuplicates(config);
+			silenced.str({});
+			run.StartTiming();
+			RemoveDuplicates(server);
+			run.StopTiming();
+		}
+		std::cout.rdbuf(cout_buffer);
+	};
+	return benchmark_case;
+}
+
+BenchmarkCase MakeProcessQueries(Corpora& corpora, const CorpusConfig& config) {
+	BenchmarkCase benchmark_case;
+	SetNameAndParams(benchmark_case, "ProcessQueries"s, config, ConfigParams::ALL);
+	benchmark_case.items_per_iteration = BATCH_QUERY_COUNT;
+	benchmark_case.function = [&corpora, config](BenchmarkRun& run) {
+		const SearchServer& server = corpora.GetServer(config);
+		const auto& queries = corpora.GetQueries(config, BATCH_QUERY_COUNT);
+		size_t document_count = 0;
+		run.StartTiming();
+		for (size_t i = 0; i < run.GetIterations(); ++i) {
+			for (const auto& documents : ProcessQueries(server, queries)) {
+				document_count += documents.size();
+			}
+		}
+		run.StopTiming();
+		if (document_count == SIZE_MAX) {
+			std::cerr << document_count;
+		}
+	};
+	return benchmark_case;
+}
+
+// Every sweep varies one parameter of the default config; a case that several sweeps
+// share runs once.
+std::vector<BenchmarkCase> MakeCases(Corpora& corpora) {
+	const CorpusConfig default_config;
+	std::vector<CorpusConfig> document_sweep, vocabulary_sweep, query_word_sweep, minus_sweep;
+	for (const int document_count : { 1'000, 10'000, 50'000 }) {
+		document_sweep.push_back(default_config);
+		document_sweep.back().document_count = document_count;
+	}
+	for (const int vocabulary_size : { 1'000, 10'000 }) {
+		vocabulary_sweep.push_back(default_config);
+		vocabulary_sweep.back().vocabulary_size = vocabulary_size;
+	}
+	for (const int query_word_count : { 3, 10, 30 }) {
+		query_word_sweep.push_back(default_config);
+		query_word_sweep.back().query_word_count = query_word_count;
+	}
+	for (const double minus_prob : { 0.0, 0.1, 0.3 }) {
+		minus_sweep.push_back(default_config);
+		minus_sweep.back().minus_prob = minus_prob;
+	}
+	const auto concat = [](std::initializer_list<const std::vector<CorpusConfig>*> sweeps) {
+		std::vector<CorpusConfig> configs;
+		for (const auto* sweep : sweeps) {
+			configs.insert(configs.end(), sweep->begin(), sweep->end());
+		}
+		return configs;
+	};
+
+	std::vector<BenchmarkCase> cases;
+	std::set<std::string> names;
+	const auto add = [&cases, &names](BenchmarkCase benchmark_case) {
+		if (names.insert(benchmark_case.name).second) {
+			cases.push_back(std::move(benchmark_case));
+		}
+	};
+	for (const CorpusConfig& config : concat({ &document_sweep, &vocabulary_sweep })) {
+		add(MakeAddDocument(corpora, config));
+	}
+	for (const CorpusConfig& config : concat({ &document_sweep, &vocabulary_sweep, &query_word_sweep, &minus_sweep })) {
+		add(MakeFindTopDocuments(corpora, config, "seq"s, std::execution::seq));
+		add(MakeFindTopDocuments(corpora, config, "par"s, std::execution::par));
+	}
+	for (const CorpusConfig& config : concat({ &document_sweep, &query_word_sweep })) {
+		add(MakeMatchDocument(corpora, config, "seq"s, std::execution::seq));
+		add(MakeMatchDocument(corpora, config, "par"s, std::execution::par));
+	}
+	for (const CorpusConfig& config : document_sweep) {
+		add(MakeRemoveDocument(corpora, config));
+		add(MakeRemoveDuplicates(corpora, config));
+	}
+	for (const CorpusConfig& config : concat({ &document_sweep, &minus_sweep })) {
+		add(MakeProcessQueries(corpora, config));
+	}
+	return cases;
+}
+
+std::string FormatDuration(double nanoseconds) {
+	std::ostringstream output;
+	output << std::fixed << std::setprecision(2);
+	if (nanoseconds >= 1e6) {
+		output << nanoseconds / 1e6 << " ms"s;
+	}
+	else if (nanoseconds >= 1e3) {
+		output << nanoseconds / 1e3 << " us"s;
+	}
+	else {
+		output << nanoseconds << " ns"s;
+	}
+	return output.str();
+}
+
+std::string_view GetVerdictName(BenchmarkVerdict verdict) {
+	switch (verdict) {
+	case BenchmarkVerdict::FASTER:
+		return "faster";
+	case BenchmarkVerdict::SLOWER:
+		return "SLOWER";
+	case BenchmarkVerdict::SAME:
+		return "same";
+	default:
+		return "new";
+	}
+}
+
+void PrintUsage() {
+	std::cerr << "Usage: search_server_benchmark [--list] [--demos] [--filter=TEXT] [--seed=N] [--samples=N] [--min-time-ms=N]\n"
+		"                              [--json=OUT.json] [--baseline=BASE.json] [--threshold=PERCENT]\n"
+		"Runs the cases whose names contain TEXT. With a baseline, exits with 1 when a case got\n"
+		"slower by more than PERCENT (5 by default) with non-overlapping confidence intervals.\n"
+		"--demos runs the timed walkthroughs of the index features instead of the cases.\n"s;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+	BenchmarkOptions options;
+	uint32_t seed = DEFAULT_SEED;
+	std::string filter;
+	std::string json_path;
+	std::string baseline_path;
+	double threshold = 0.05;
+	bool list_only = false;
+	bool demos = false;
+	try {
+		for (int i = 1; i < argc; ++i) {
+			const std::string_view arg = argv[i];
+			const size_t equals = arg.find('=');
+			const std::string_view key = arg.substr(0, equals);
+			const std::string value(equals == std::string_view::npos ? ""sv : arg.substr(equals + 1));
+			if (key == "--list"sv) {
+				list_only = true;
+			}
+			else if (key == "--demos"sv) {
+				demos = true;
+			}
+			else if (key == "--filter"sv) {
+				filter = value;
+			}
+			else if (key == "--seed"sv) {
+				seed = static_cast<uint32_t>(std::stoul(value));
+			}
+			else if (key == "--samples"sv) {
+				options.sample_count = std::stoul(value);
+			}
+			else if (key == "--min-time-ms"sv) {
+				options.min_sample_time = std::chrono::milliseconds(std::stoul(value));
+			}
+			else if (key == "--json"sv) {
+				json_path = value;
+			}
+			else if (key == "--baseline"sv) {
+				baseline_path = value;
+			}
+			else if (key == "--threshold"sv) {
+				threshold = std::stod(value) / 100.0;
+			}
+			else {
+				PrintUsage();
+				return 2;
+			}
+		}
+	}
+	catch (const std::exception&) {
+		PrintUsage();
+		return 2;
+	}
+
+	if (demos) {
+		RunDemos();
+		return 0;
+	}
+
+	std::map<std::string, BenchmarkResult> baseline;
+	if (!baseline_path.empty()) {
+		std::ifstream input(baseline_path);
+		if (!input) {
+			std::cerr << "Cannot open baseline "s << baseline_path << std::endl;
+			return 2;
+		}
+		baseline = ReadBenchmarkBaseline(input);
+	}
+
+	Corpora corpora(seed);
+	std::vector<BenchmarkResult> results;
+	for (const BenchmarkCase& benchmark_case : MakeCases(corpora)) {
+		if (benchmark_case.name.find(filter) == std::string::npos) {
+			continue;
+		}
+		if (list_only) {
+			std::cout << benchmark_case.name << std::endl;
+			continue;
+		}
+		results.push_back(RunBenchmark(benchmark_case, options));
+		const BenchmarkResult& result = results.back();
+		std::cout << std::left << std::setw(90) << result.name << std::right << std::setw(12) << FormatDuration(result.median_ns)
+			<< "  ["s << FormatDuration(result.ci_low_ns) << ", "s << FormatDuration(result.ci_high_ns) << "]  "s
+			<< std::setprecision(4) << result.items_per_second << " items/s"s << std::endl;
+	}
+
+	if (!json_path.empty()) {
+		std::ofstream output(json_path);
+		WriteBenchmarkJson(output, results, options);
+	}
+
+	bool has_regressions = false;
+	if (!baseline_path.empty()) {
+		std::cout << "\nAgainst "s << baseline_path << ":\n"s;
+		for (const BenchmarkComparison& comparison : CompareWithBaseline(results, baseline, threshold)) {
+			std::cout << std::left << std::setw(90) << comparison.name << std::right << std::setw(8) << GetVerdictName(comparison.verdict);
+			if (comparison.verdict != BenchmarkVerdict::NEW) {
+				std::cout << std::showpos << std::fixed << std::setprecision(1) << std::setw(9) << comparison.change * 100 << '%'
+					<< std::noshowpos << std::defaultfloat;
+			}
+			std::cout << std::endl;
+			has_regressions = has_regressions || comparison.verdict == BenchmarkVerdict::SLOWER;
+		}
+	}
+	return has_regressions ? 1 : 0;
+}
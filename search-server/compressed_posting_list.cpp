@@ -0,0 +1,270 @@
+#include "compressed_posting_list.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <tmmintrin.h>
+#define STREAM_VBYTE_SSSE3 __attribute__((target("ssse3")))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <tmmintrin.h>
+#define STREAM_VBYTE_SSSE3
+#endif
+
+namespace {
+	// the decoder reads whole 16-byte words, so the buffer is padded past its last value
+	const size_t INPUT_PADDING = 16;
+
+	// Stream VByte: a control byte holds the byte lengths minus one of four values
+	struct StreamVByteTables {
+		uint8_t lengths[256];
+		uint8_t shuffles[256][16];
+	};
+
+	StreamVByteTables BuildStreamVByteTables() {
+		StreamVByteTables tables;
+		for (int control = 0; control < 256; ++control) {
+			uint8_t offset = 0;
+			for (int value = 0; value < 4; ++value) {
+				const int length = ((control >> (2 * value)) & 3) + 1;
+				for (int byte = 0; byte < 4; ++byte) {
+					tables.shuffles[control][4 * value + byte] = byte < length ? static_cast<uint8_t>(offset + byte) : 0x80;
+				}
+				offset += length;
+			}
+			tables.lengths[control] = offset;
+		}
+		return tables;
+	}
+
+	const StreamVByteTables& GetStreamVByteTables() {
+		static const StreamVByteTables tables = BuildStreamVByteTables();
+		return tables;
+	}
+
+	int GetByteLength(uint32_t value) {
+		return value < (1u << 8) ? 1 : value < (1u << 16) ? 2 : value < (1u << 24) ? 3 : 4;
+	}
+
+	// count must be a multiple of 4: control bytes first, then the data bytes
+	void EncodeStream(const uint32_t* values, size_t count, std::vector<uint8_t>& bytes) {
+		const size_t controls = bytes.size();
+		bytes.resize(bytes.size() + count / 4, 0);
+		for (size_t i = 0; i < count; ++i) {
+			const int length = GetByteLength(values[i]);
+			bytes[controls + i / 4] |= static_cast<uint8_t>((length - 1) << (2 * (i % 4)));
+			for (int byte = 0; byte < length; ++byte) {
+				bytes.push_back(static_cast<uint8_t>(values[i] >> (8 * byte)));
+			}
+		}
+	}
+
+	// with is_delta, values are gaps and are turned into running sums starting from base
+	const uint8_t* DecodeStreamScalar(const uint8_t* input, size_t count, uint32_t* values, uint32_t base, bool is_delta) {
+		const uint8_t* controls = input;
+		const uint8_t* data = input + count / 4;
+		for (size_t i = 0; i < count; ++i) {
+			const int length = ((controls[i / 4] >> (2 * (i % 4))) & 3) + 1;
+			uint32_t value = 0;
+			for (int byte = 0; byte < length; ++byte) {
+				value |= static_cast<uint32_t>(data[byte]) << (8 * byte);
+			}
+			data += length;
+			if (is_delta) {
+				base += value;
+				value = base;
+			}
+			values[i] = value;
+		}
+		return data;
+	}
+
+#ifdef STREAM_VBYTE_SSSE3
+	// one shuffle spreads the bytes of four values into four 32-bit lanes
+	STREAM_VBYTE_SSSE3
+	const uint8_t* DecodeStreamSsse3(const uint8_t* input, size_t count, uint32_t* values, uint32_t base, bool is_delta) {
+		const StreamVByteTables& tables = GetStreamVByteTables();
+		const uint8_t* controls = input;
+		const uint8_t* data = input + count / 4;
+		__m128i previous = _mm_set1_epi32(static_cast<int>(base));
+		for (size_t group = 0; group < count / 4; ++group) {
+			const uint8_t control = controls[group];
+			const __m128i shuffle = _mm_loadu_si128(reinterpret_cast<const __m128i*>(tables.shuffles[control]));
+			__m128i group_values = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data)), shuffle);
+			data += tables.lengths[control];
+			if (is_delta) {
+				// prefix sum of the four gaps plus the last value of the previous group
+				group_values = _mm_add_epi32(group_values, _mm_slli_si128(group_values, 4));
+				group_values = _mm_add_epi32(group_values, _mm_slli_si128(group_values, 8));
+				group_values = _mm_add_epi32(group_values, previous);
+				previous = _mm_shuffle_epi32(group_values, 0xFF);
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(values + 4 * group), group_values);
+		}
+		return data;
+	}
+
+	bool HasSsse3() {
+#if defined(_MSC_VER)
+		int cpu_info[4];
+		__cpuid(cpu_info, 1);
+		return (cpu_info[2] & (1 << 9)) != 0;
+#else
+		return __builtin_cpu_supports("ssse3");
+#endif
+	}
+#endif
+
+	const uint8_t* DecodeStream(const uint8_t* input, size_t count, uint32_t* values, uint32_t base, bool is_delta) {
+#ifdef STREAM_VBYTE_SSSE3
+		static const bool has_ssse3 = HasSsse3();
+		if (has_ssse3) {
+			return DecodeStreamSsse3(input, count, values, base, is_delta);
+		}
+#endif
+		return DecodeStreamScalar(input, count, values, base, is_delta);
+	}
+
+	size_t RoundUpToGroup(size_t count) {
+		return (count + 3) / 4 * 4;
+	}
+}
+
+CompressedPostingList::CompressedPostingList(const PostingList& postings, std::shared_ptr<const TermFreqCodebook> codebook)
+	: codebook_(std::move(codebook)), size_(postings.size()), max_term_freq_(postings.GetMaxTermFreq()) {
+	uint32_t gaps[BLOCK_SIZE];
+	uint32_t term_freq_codes[BLOCK_SIZE];
+	skips_.reserve((size_ + BLOCK_SIZE - 1) / BLOCK_SIZE);
+	DocumentOrdinal previous = 0;
+	for (size_t first = 0; first < size_; first += BLOCK_SIZE) {
+		const size_t count = std::min(BLOCK_SIZE, size_ - first);
+		double max_term_freq = 0.0;
+		for (size_t i = 0; i < count; ++i) {
+			const auto [ordinal, term_freq] = postings.GetPosting(first + i);
+			gaps[i] = ordinal - previous;
+			previous = ordinal;
+			term_freq_codes[i] = static_cast<uint32_t>(
+				std::lower_bound(codebook_->begin(), codebook_->end(), term_freq) - codebook_->begin());
+			max_term_freq = std::max(max_term_freq, term_freq);
+		}
+		// the last group of a block is padded with zeros, so the decoder only sees whole groups
+		const size_t padded_count = RoundUpToGroup(count);
+		std::fill(gaps + count, gaps + padded_count, 0);
+		std::fill(term_freq_codes + count, term_freq_codes + padded_count, 0);
+
+		skips_.push_back({ previous, static_cast<uint32_t>(bytes_.size()), max_term_freq });
+		EncodeStream(gaps, padded_count, bytes_);
+		EncodeStream(term_freq_codes, padded_count, bytes_);
+	}
+	bytes_.resize(bytes_.size() + INPUT_PADDING, 0);
+	bytes_.shrink_to_fit();
+}
+
+PostingList CompressedPostingList::Decompress() const {
+	PostingList postings;
+	DocumentOrdinal ordinals[BLOCK_SIZE];
+	uint32_t term_freq_codes[BLOCK_SIZE];
+	for (size_t block = 0; block < skips_.size(); ++block) {
+		const size_t count = DecodeBlock(block, ordinals, term_freq_codes);
+		for (size_t i = 0; i < count; ++i) {
+			postings.AddTermFreq(ordinals[i], (*codebook_)[term_freq_codes[i]]);
+		}
+	}
+	return postings;
+}
+
+bool CompressedPostingList::Contains(DocumentOrdinal ordinal) const {
+	const size_t block = FindBlock(ordinal, 0);
+	if (block == skips_.size()) {
+		return false;
+	}
+	DocumentOrdinal ordinals[BLOCK_SIZE];
+	uint32_t term_freq_codes[BLOCK_SIZE];
+	const size_t count = DecodeBlock(block, ordinals, term_freq_codes);
+	return std::binary_search(ordinals, ordinals + count, ordinal);
+}
+
+double CompressedPostingList::GetMaxTermFreq() const {
+	return max_term_freq_;
+}
+
+size_t CompressedPostingList::size() const {
+	return size_;
+}
+
+bool CompressedPostingList::empty() const {
+	return size_ == 0;
+}
+
+size_t CompressedPostingList::GetMemoryUsage() const {
+	return sizeof(*this) + bytes_.capacity() + skips_.capacity() * sizeof(SkipEntry);
+}
+
+size_t CompressedPostingList::FindBlock(DocumentOrdinal ordinal, size_t first_block) const {
+	return std::lower_bound(skips_.begin() + first_block, skips_.end(), ordinal,
+		[](const SkipEntry& skip, DocumentOrdinal ordinal) {
+			return skip.last_ordinal < ordinal;
+		}) - skips_.begin();
+}
+
+size_t CompressedPostingList::DecodeBlock(size_t block, DocumentOrdinal* ordinals, uint32_t* term_freq_codes) const {
+	const size_t count = std::min(BLOCK_SIZE, size_ - block * BLOCK_SIZE);
+	const size_t padded_count = RoundUpToGroup(count);
+	const DocumentOrdinal base = block > 0 ? skips_[block - 1].last_ordinal : 0;
+	const uint8_t* input = bytes_.data() + skips_[block].offset;
+	input = DecodeStream(input, padded_count, ordinals, base, true);
+	DecodeStream(input, padded_count, term_freq_codes, 0, false);
+	return count;
+}
+
+CompressedPostingList::Cursor::Cursor(const CompressedPostingList& postings)
+	: postings_(&postings) {
+	LoadBlock(0);
+}
+
+void CompressedPostingList::Cursor::SkipTo(DocumentOrdinal ordinal) {
+	if (ordinal <= ordinal_) {
+		return;
+	}
+	if (ordinal > postings_->skips_[block_].last_ordinal) {
+		// jump over whole blocks by their skip entries, decoding only the target one
+		const size_t block = postings_->FindBlock(ordinal, block_ + 1);
+		LoadBlock(block);
+		if (IsEnd()) {
+			return;
+		}
+	}
+	position_ = std::lower_bound(ordinals_.begin() + position_, ordinals_.begin() + block_size_, ordinal) - ordinals_.begin();
+	ordinal_ = ordinals_[position_];
+}
+
+double CompressedPostingList::Cursor::GetBlockMaxTermFreqAt(DocumentOrdinal ordinal) {
+	const auto& skips = postings_->skips_;
+	shallow_block_ = std::max(shallow_block_, block_);
+	while (shallow_block_ < skips.size() && skips[shallow_block_].last_ordinal < ordinal) {
+		++shallow_block_;
+	}
+	return shallow_block_ < skips.size() ? skips[shallow_block_].max_term_freq : 0.0;
+}
+
+double CompressedPostingList::Cursor::GetMaxTermFreqIn(DocumentOrdinal first, DocumentOrdinal last) {
+	const auto& skips = postings_->skips_;
+	double max_term_freq = GetBlockMaxTermFreqAt(first);
+	for (size_t block = shallow_block_; block + 1 < skips.size() && skips[block].last_ordinal < last; ++block) {
+		max_term_freq = std::max(max_term_freq, skips[block + 1].max_term_freq);
+	}
+	return max_term_freq;
+}
+
+void CompressedPostingList::Cursor::LoadBlock(size_t block) {
+	block_ = block;
+	position_ = 0;
+	if (block >= postings_->skips_.size()) {
+		block_size_ = 0;
+		ordinal_ = END;
+		return;
+	}
+	block_size_ = postings_->DecodeBlock(block, ordinals_.data(), term_freq_codes_.data());
+	ordinal_ = ordinals_[0];
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "posting_list.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Sorted distinct term_freq values of an index. Compressed lists quantize a
+// term_freq to its index in this table instead of storing the double, and
+// since the table is exact, decoded frequencies are bit-identical.
+using TermFreqCodebook = std::vector<double>;
+
+// Read-only posting list compressed in blocks of BLOCK_SIZE postings:
+// ordinals as deltas and term_freq codes, both in Stream VByte format
+// (2-bit length per value in control bytes, 1-4 data bytes per value).
+// Blocks are decoded with SSSE3 shuffles when the CPU has them.
+// Every block keeps a skip entry (last ordinal, byte offset, max term_freq),
+// so cursors jump over blocks without decoding them.
+class CompressedPostingList {
+public:
+	static constexpr size_t BLOCK_SIZE = 128;
+
+	class Cursor;
+
+	CompressedPostingList() = default;
+
+	// every term_freq of postings must be present in codebook
+	CompressedPostingList(const PostingList& postings, std::shared_ptr<const TermFreqCodebook> codebook);
+
+	PostingList Decompress() const;
+
+	bool Contains(DocumentOrdinal ordinal) const;
+
+	double GetMaxTermFreq() const;
+
+	size_t size() const;
+
+	bool empty() const;
+
+	// bytes owned by the list, the shared codebook is not included
+	size_t GetMemoryUsage() const;
+
+private:
+	struct SkipEntry {
+		DocumentOrdinal last_ordinal;
+		uint32_t offset;
+		double max_term_freq;
+	};
+
+	std::vector<uint8_t> bytes_;
+	std::vector<SkipEntry> skips_;
+	std::shared_ptr<const TermFreqCodebook> codebook_;
+	size_t size_ = 0;
+	double max_term_freq_ = 0.0;
+
+	// first block at or after first_block whose last ordinal is not less than ordinal
+	size_t FindBlock(DocumentOrdinal ordinal, size_t first_block) const;
+
+	size_t DecodeBlock(size_t block, DocumentOrdinal* ordinals, uint32_t* term_freq_codes) const;
+};
+
+// Same interface as PostingCursor; decodes one block at a time
+class CompressedPostingList::Cursor {
+public:
+	static constexpr DocumentOrdinal END = PostingCursor::END;
+
+	explicit Cursor(const CompressedPostingList& postings);
+
+	bool IsEnd() const {
+		return ordinal_ == END;
+	}
+
+	DocumentOrdinal GetOrdinal() const {
+		return ordinal_;
+	}
+
+	double GetTermFreq() const {
+		return (*postings_->codebook_)[term_freq_codes_[position_]];
+	}
+
+	void Next() {
+		if (++position_ < block_size_) {
+			ordinal_ = ordinals_[position_];
+		}
+		else {
+			LoadBlock(block_ + 1);
+		}
+	}
+
+	void SkipTo(DocumentOrdinal ordinal);
+
+	double GetMaxTermFreq() const {
+		return postings_->max_term_freq_;
+	}
+
+	double GetBlockMaxTermFreq() const {
+		return postings_->skips_[block_].max_term_freq;
+	}
+
+	DocumentOrdinal GetBlockLastOrdinal() const {
+		return postings_->skips_[block_].last_ordinal;
+	}
+
+	// bound of the block that would hold ordinal, read from the skip entries only
+	double GetBlockMaxTermFreqAt(DocumentOrdinal ordinal);
+
+	// bound of the blocks that would hold the ordinals [first, last], the same way
+	double GetMaxTermFreqIn(DocumentOrdinal first, DocumentOrdinal last);
+
+private:
+	const CompressedPostingList* postings_;
+	size_t block_ = 0;
+	size_t shallow_block_ = 0;
+	size_t block_size_ = 0;
+	size_t position_ = 0;
+	DocumentOrdinal ordinal_ = END;
+	std::array<DocumentOrdinal, BLOCK_SIZE> ordinals_;
+	std::array<uint32_t, BLOCK_SIZE> term_freq_codes_;
+
+	void LoadBlock(size_t block);
+};
@@ -0,0 +1,88 @@
+#include "concurrent_search_server.h"
+
+#include <exception>
+#include <thread>
+
+ConcurrentSearchServer::ConcurrentSearchServer(const std::string& stop_words_text)
+	: replicas_{ SearchServer(stop_words_text), SearchServer(stop_words_text) } {
+}
+
+ConcurrentSearchServer::ConcurrentSearchServer(std::string_view stop_words_view)
+	: replicas_{ SearchServer(stop_words_view), SearchServer(stop_words_view) } {
+}
+
+void ConcurrentSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status,
+	const std::vector<int>& ratings) {
+	Write([&](SearchServer& search_server) {
+		search_server.AddDocument(document_id, document, status, ratings);
+		});
+}
+
+void ConcurrentSearchServer::AddDocuments(const std::vector<NewDocument>& documents) {
+	Write([&](SearchServer& search_server) {
+		search_server.AddDocuments(documents);
+		});
+}
+
+void ConcurrentSearchServer::UpdateDocument(int document_id, std::string_view document, DocumentStatus status,
+	const std::vector<int>& ratings) {
+	Write([&](SearchServer& search_server) {
+		search_server.UpdateDocument(document_id, document, status, ratings);
+		});
+}
+
+void ConcurrentSearchServer::RemoveDocument(int document_id) {
+	Write([&](SearchServer& search_server) {
+		search_server.RemoveDocument(document_id);
+		});
+}
+
+void ConcurrentSearchServer::SetRankingMode(RankingMode ranking_mode) {
+	Write([&](SearchServer& search_server) {
+		search_server.SetRankingMode(ranking_mode);
+		});
+}
+
+int ConcurrentSearchServer::GetDocumentCount() const {
+	return Read([](const SearchServer& search_server) {
+		return search_server.GetDocumentCount();
+		});
+}
+
+void ConcurrentSearchServer::Write(const std::function<void(SearchServer&)>& change) {
+	std::lock_guard guard(write_mutex_);
+
+	// a change that throws may still have been applied in part, as AddDocuments is,
+	// so it is published and replayed all the same and its first exception rethrown
+	const size_t published = published_.load();
+	std::exception_ptr error;
+	try {
+		change(replicas_[1 - published]);
+	}
+	catch (...) {
+		error = std::current_exception();
+	}
+	published_.store(1 - published);
+
+	// new readers go to the other epoch, then both epochs are drained: a reader that
+	// read published_ before the store has arrived at one of them
+	const size_t epoch = epoch_.load();
+	WaitForReaders(1 - epoch);
+	epoch_.store(1 - epoch);
+	WaitForReaders(epoch);
+
+	try {
+		change(replicas_[published]);
+	}
+	catch (...) {
+	}
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+
+void ConcurrentSearchServer::WaitForReaders(size_t epoch) const {
+	while (read_indicators_[epoch].reader_count.load() != 0) {
+		std::this_thread::yield();
+	}
+}
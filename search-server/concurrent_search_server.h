@@ -0,0 +1,92 @@
+#pragma once
+
+#include "search_server.h"
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// SearchServer for concurrent readers and writers, built on the left-right variant of
+// RCU. Two replicas of the index are kept. Readers announce themselves in an epoch
+// indicator and read the published replica without locks, so a write never stalls a
+// query. A writer applies its change to the hidden replica, publishes it with one
+// atomic store, waits until every reader of the old replica has left its epoch and
+// replays the change there. Writers are serialized among themselves.
+class ConcurrentSearchServer {
+public:
+	template <typename StringContainer>
+	explicit ConcurrentSearchServer(const StringContainer& stop_words);
+
+	explicit ConcurrentSearchServer(const std::string& stop_words_text);
+
+	explicit ConcurrentSearchServer(std::string_view stop_words_view);
+
+	void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+	void AddDocuments(const std::vector<NewDocument>& documents);
+
+	void UpdateDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+	void RemoveDocument(int document_id);
+
+	void SetRankingMode(RankingMode ranking_mode);
+
+	// Calls function with the published replica, which stays unchanged until it returns.
+	// The result must not refer into the replica: string_views do not outlive the call.
+	template <typename Function>
+	auto Read(Function function) const;
+
+	// any overload of SearchServer::FindTopDocuments, with its result type
+	template <typename... Args>
+	auto FindTopDocuments(Args&&... args) const;
+
+	int GetDocumentCount() const;
+
+private:
+	struct alignas(64) ReadIndicator {
+		std::atomic<size_t> reader_count{ 0 };
+	};
+
+	SearchServer replicas_[2];
+	// replica the readers use
+	std::atomic<size_t> published_{ 0 };
+	// readers arrive at the indicator of the current epoch before they look at published_
+	std::atomic<size_t> epoch_{ 0 };
+	mutable ReadIndicator read_indicators_[2];
+	std::mutex write_mutex_;
+
+	void Write(const std::function<void(SearchServer&)>& change);
+
+	void WaitForReaders(size_t epoch) const;
+};
+
+template <typename StringContainer>
+ConcurrentSearchServer::ConcurrentSearchServer(const StringContainer& stop_words)
+	: replicas_{ SearchServer(stop_words), SearchServer(stop_words) } {
+}
+
+template <typename Function>
+auto ConcurrentSearchServer::Read(Function function) const {
+	struct Departure {
+		ReadIndicator& indicator;
+
+		~Departure() {
+			indicator.reader_count.fetch_sub(1);
+		}
+	};
+
+	ReadIndicator& indicator = read_indicators_[epoch_.load()];
+	indicator.reader_count.fetch_add(1);
+	const Departure departure{ indicator };
+	return function(static_cast<const SearchServer&>(replicas_[published_.load()]));
+}
+
+template <typename... Args>
+auto ConcurrentSearchServer::FindTopDocuments(Args&&... args) const {
+	return Read([&](const SearchServer& search_server) {
+		return search_server.FindTopDocuments(std::forward<Args>(args)...);
+		});
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <random>
+#include <string>
+#include <vector>
+
+// Random corpora for benchmarks; the same seed of the generator gives the same texts.
+
+// lowercase latin word of 1 to max_length letters
+std::string GenerateWord(std::mt19937& generator, int max_length);
+
+// words that follow each other are distinct, others may repeat
+std::vector<std::string> GenerateDictionary(std::mt19937& generator, int word_count, int max_length);
+
+// each word is a minus word with probability minus_prob
+std::string GenerateQuery(std::mt19937& generator, const std::vector<std::string>& dictionary, int word_count, double minus_prob = 0);
+
+std::vector<std::string> GenerateQueries(std::mt19937& generator, const std::vector<std::string>& dictionary, int query_count,
+	int max_word_count, double minus_prob = 0);
+
+// Ranks 0..count-1, rank r drawn with probability proportional to 1 / (r + 1)^exponent,
+// so a few queries make up most of the traffic as in real query logs
+class ZipfDistribution {
+public:
+	ZipfDistribution(size_t count, double exponent);
+
+	size_t operator()(std::mt19937& generator) const;
+
+private:
+	std::vector<double> cumulative_weights_;
+};
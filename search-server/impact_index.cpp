@@ -0,0 +1,94 @@
+#include "impact_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+ImpactList::ImpactList(const SegmentedPostings& postings, double inverse_document_freq, uint64_t term_version)
+	: inverse_document_freq_(inverse_document_freq), term_version_(term_version) {
+	std::vector<std::pair<uint16_t, DocumentOrdinal>> impacts;
+	for (SegmentedPostingCursor cursor(postings); !cursor.IsEnd(); cursor.Next()) {
+		const double exact_impact = cursor.GetTermFreq() * inverse_document_freq * IMPACT_SCALE;
+		const double impact = std::min(std::round(exact_impact), static_cast<double>(std::numeric_limits<uint16_t>::max()));
+		max_rounding_error_ = std::max(max_rounding_error_, std::abs(impact - exact_impact));
+		max_exact_impact_ = std::max(max_exact_impact_, exact_impact);
+		impacts.push_back({ static_cast<uint16_t>(impact), cursor.GetOrdinal() });
+	}
+	// the cursor yields ordinals in order, a stable sort keeps them so within a segment
+	std::stable_sort(impacts.begin(), impacts.end(), [](const auto& lhs, const auto& rhs) {
+		return lhs.first > rhs.first;
+	});
+
+	ordinals_.reserve(impacts.size());
+	for (const auto& [impact, ordinal] : impacts) {
+		if (segments_.empty() || segments_.back().impact != impact) {
+			const uint32_t first = static_cast<uint32_t>(ordinals_.size());
+			segments_.push_back({ impact, first, first });
+		}
+		ordinals_.push_back(ordinal);
+		++segments_.back().last;
+	}
+}
+
+const std::vector<ImpactList::Segment>& ImpactList::GetSegments() const {
+	return segments_;
+}
+
+const std::vector<DocumentOrdinal>& ImpactList::GetOrdinals() const {
+	return ordinals_;
+}
+
+double ImpactList::GetInverseDocumentFreq() const {
+	return inverse_document_freq_;
+}
+
+uint64_t ImpactList::GetTermVersion() const {
+	return term_version_;
+}
+
+double ImpactList::GetMaxError(double inverse_document_freq) const {
+	if (inverse_document_freq_ == 0.0) {
+		// every impact is 0, the exact ones are tf * idf for the new idf
+		return IMPACT_SCALE * inverse_document_freq;
+	}
+	return max_rounding_error_ + max_exact_impact_ * std::abs(inverse_document_freq / inverse_document_freq_ - 1.0);
+}
+
+ImpactIndex::ImpactIndex(const ImpactIndex&) {
+}
+
+ImpactIndex& ImpactIndex::operator=(const ImpactIndex& other) {
+	if (this != &other) {
+		Clear();
+	}
+	return *this;
+}
+
+std::shared_ptr<const ImpactList> ImpactIndex::GetList(TermId term_id, const SegmentedPostings& postings,
+	double inverse_document_freq, uint64_t term_version) const {
+	const auto is_fresh = [&](const std::shared_ptr<const ImpactList>& list) {
+		return list != nullptr && list->GetTermVersion() == term_version
+			&& std::abs(inverse_document_freq - list->GetInverseDocumentFreq()) <= MAX_IDF_DRIFT * list->GetInverseDocumentFreq();
+	};
+	{
+		std::lock_guard guard(mutex_);
+		if (term_id < lists_.size() && is_fresh(lists_[term_id])) {
+			return lists_[term_id];
+		}
+	}
+
+	// built outside the lock, so lookups of other terms go on meanwhile
+	auto list = std::make_shared<const ImpactList>(postings, inverse_document_freq, term_version);
+	std::lock_guard guard(mutex_);
+	if (term_id >= lists_.size()) {
+		lists_.resize(term_id + 1);
+	}
+	lists_[term_id] = list;
+	return list;
+}
+
+void ImpactIndex::Clear() {
+	std::lock_guard guard(mutex_);
+	lists_.clear();
+}
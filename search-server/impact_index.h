@@ -0,0 +1,75 @@
+#pragma once
+
+#include "index_segment.h"
+#include "posting_list.h"
+#include "term_dictionary.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Postings of one term ordered by impact: tf * idf quantized to 16 bits in units of
+// 1 / IMPACT_SCALE. Postings of equal impact form a segment and are kept in ordinal
+// order, segments go from the highest impact down.
+class ImpactList {
+public:
+	static constexpr double IMPACT_SCALE = 2048.0;
+
+	struct Segment {
+		uint16_t impact;
+		// range of the segment in GetOrdinals()
+		uint32_t first;
+		uint32_t last;
+	};
+
+	ImpactList(const SegmentedPostings& postings, double inverse_document_freq, uint64_t term_version);
+
+	const std::vector<Segment>& GetSegments() const;
+
+	const std::vector<DocumentOrdinal>& GetOrdinals() const;
+
+	// idf the impacts were computed with
+	double GetInverseDocumentFreq() const;
+
+	uint64_t GetTermVersion() const;
+
+	// Bound of |impact - tf * idf * IMPACT_SCALE| over the postings for the current idf,
+	// which may have drifted from the one of the list
+	double GetMaxError(double inverse_document_freq) const;
+
+private:
+	std::vector<Segment> segments_;
+	std::vector<DocumentOrdinal> ordinals_;
+	double inverse_document_freq_;
+	uint64_t term_version_;
+	double max_rounding_error_ = 0.0;
+	double max_exact_impact_ = 0.0;
+};
+
+// Impact lists of the terms, built on first use and rebuilt lazily: when the postings
+// of a term changed or its idf drifted by more than MAX_IDF_DRIFT since the build.
+// Lookups from several threads are safe. Copies start empty.
+class ImpactIndex {
+public:
+	static constexpr double MAX_IDF_DRIFT = 0.01;
+
+	ImpactIndex() = default;
+
+	ImpactIndex(const ImpactIndex&);
+
+	ImpactIndex& operator=(const ImpactIndex&);
+
+	// term_version must change whenever the postings of the term change
+	std::shared_ptr<const ImpactList> GetList(TermId term_id, const SegmentedPostings& postings,
+		double inverse_document_freq, uint64_t term_version) const;
+
+	// drops every list, for when the ordinals are renumbered
+	void Clear();
+
+private:
+	mutable std::mutex mutex_;
+	// indexed by TermId
+	mutable std::vector<std::shared_ptr<const ImpactList>> lists_;
+};
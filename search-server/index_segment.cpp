@@ -0,0 +1,214 @@
+#include "index_segment.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+namespace {
+
+std::shared_ptr<const TermFreqCodebook> BuildCodebook(const std::vector<PostingList>& postings) {
+	// distinct frequencies are few, hashing them is cheaper than sorting every posting
+	std::unordered_set<double> distinct_term_freqs;
+	for (const PostingList& term_postings : postings) {
+		for (const auto& posting : term_postings) {
+			distinct_term_freqs.insert(posting.term_freq);
+		}
+	}
+	TermFreqCodebook term_freqs(distinct_term_freqs.begin(), distinct_term_freqs.end());
+	std::sort(term_freqs.begin(), term_freqs.end());
+	return std::make_shared<const TermFreqCodebook>(std::move(term_freqs));
+}
+
+} // namespace
+
+IndexSegment::IndexSegment(DocumentOrdinal first_ordinal, DocumentOrdinal last_ordinal, const std::vector<PostingList>& postings,
+	std::shared_ptr<const TermFreqCodebook> codebook)
+	: first_ordinal_(first_ordinal), last_ordinal_(last_ordinal), codebook_(std::move(codebook)) {
+	// terms missing at the end are left out, FindPostings treats them as empty
+	size_t term_count = postings.size();
+	while (term_count > 0 && postings[term_count - 1].empty()) {
+		--term_count;
+	}
+	postings_.reserve(term_count);
+	for (size_t term_id = 0; term_id < term_count; ++term_id) {
+		posting_count_ += postings[term_id].size();
+		postings_.emplace_back(postings[term_id], codebook_);
+	}
+}
+
+DocumentOrdinal IndexSegment::GetFirstOrdinal() const {
+	return first_ordinal_;
+}
+
+DocumentOrdinal IndexSegment::GetLastOrdinal() const {
+	return last_ordinal_;
+}
+
+const CompressedPostingList* IndexSegment::FindPostings(TermId term_id) const {
+	if (term_id >= postings_.size() || postings_[term_id].empty()) {
+		return nullptr;
+	}
+	return &postings_[term_id];
+}
+
+const TermFreqCodebook& IndexSegment::GetCodebook() const {
+	return *codebook_;
+}
+
+size_t IndexSegment::GetTermCount() const {
+	return postings_.size();
+}
+
+size_t IndexSegment::GetPostingCount() const {
+	return posting_count_;
+}
+
+size_t IndexSegment::GetMemoryUsage() const {
+	size_t bytes = sizeof(*this) + codebook_->capacity() * sizeof(double);
+	for (const CompressedPostingList& postings : postings_) {
+		bytes += postings.GetMemoryUsage();
+	}
+	return bytes;
+}
+
+std::shared_ptr<const IndexSegment> SealSegment(const std::vector<PostingList>& postings,
+	DocumentOrdinal first_ordinal, DocumentOrdinal last_ordinal, const std::vector<bool>& is_removed) {
+	if (std::find(is_removed.begin() + first_ordinal, is_removed.begin() + last_ordinal, true) == is_removed.begin() + last_ordinal) {
+		return std::make_shared<const IndexSegment>(first_ordinal, last_ordinal, postings, BuildCodebook(postings));
+	}
+	std::vector<PostingList> kept_postings(postings.size());
+	for (size_t term_id = 0; term_id < postings.size(); ++term_id) {
+		for (const auto [ordinal, term_freq] : postings[term_id]) {
+			if (!is_removed[ordinal]) {
+				kept_postings[term_id].AddTermFreq(ordinal, term_freq);
+			}
+		}
+	}
+	return std::make_shared<const IndexSegment>(first_ordinal, last_ordinal, kept_postings, BuildCodebook(kept_postings));
+}
+
+std::shared_ptr<const IndexSegment> MergeSegments(const std::vector<std::shared_ptr<const IndexSegment>>& segments,
+	const std::vector<bool>& is_removed, const std::vector<DocumentOrdinal>& new_ordinals) {
+	size_t term_count = 0;
+	TermFreqCodebook term_freqs;
+	for (const auto& segment : segments) {
+		term_count = std::max(term_count, segment->GetTermCount());
+		const TermFreqCodebook& codebook = segment->GetCodebook();
+		const size_t middle = term_freqs.size();
+		term_freqs.insert(term_freqs.end(), codebook.begin(), codebook.end());
+		std::inplace_merge(term_freqs.begin(), term_freqs.begin() + middle, term_freqs.end());
+		term_freqs.erase(std::unique(term_freqs.begin(), term_freqs.end()), term_freqs.end());
+	}
+	// segments are consecutive, so appending them in turn keeps every list sorted
+	std::vector<PostingList> kept_postings(term_count);
+	for (const auto& segment : segments) {
+		for (TermId term_id = 0; term_id < segment->GetTermCount(); ++term_id) {
+			const CompressedPostingList* postings = segment->FindPostings(term_id);
+			if (postings == nullptr) {
+				continue;
+			}
+			for (CompressedPostingList::Cursor cursor(*postings); !cursor.IsEnd(); cursor.Next()) {
+				const DocumentOrdinal ordinal = cursor.GetOrdinal();
+				if (!is_removed[ordinal]) {
+					kept_postings[term_id].AddTermFreq(new_ordinals.empty() ? ordinal : new_ordinals[ordinal], cursor.GetTermFreq());
+				}
+			}
+		}
+	}
+
+	DocumentOrdinal first_ordinal = segments.front()->GetFirstOrdinal();
+	DocumentOrdinal last_ordinal = segments.back()->GetLastOrdinal();
+	if (!new_ordinals.empty()) {
+		// the range shrinks to the ordinals that remain
+		const DocumentOrdinal removed_before = static_cast<DocumentOrdinal>(
+			std::count(is_removed.begin(), is_removed.begin() + first_ordinal, true));
+		const DocumentOrdinal removed_inside = static_cast<DocumentOrdinal>(
+			std::count(is_removed.begin() + first_ordinal, is_removed.begin() + last_ordinal, true));
+		first_ordinal -= removed_before;
+		last_ordinal -= removed_before + removed_inside;
+	}
+	// the union of the input codebooks may keep a few codes that removals left unused
+	term_freqs.shrink_to_fit();
+	return std::make_shared<const IndexSegment>(first_ordinal, last_ordinal, kept_postings,
+		std::make_shared<const TermFreqCodebook>(std::move(term_freqs)));
+}
+
+double SegmentedPostings::GetMaxTermFreq() const {
+	double max_term_freq = tail->GetMaxTermFreq();
+	for (const Part& part : sealed) {
+		max_term_freq = std::max(max_term_freq, part.postings->GetMaxTermFreq());
+	}
+	return max_term_freq;
+}
+
+SegmentedPostingCursor::SegmentedPostingCursor(const SegmentedPostings& postings)
+	: tail_(*postings.tail), max_term_freq_(postings.GetMaxTermFreq()) {
+	sealed_.reserve(postings.sealed.size());
+	part_ends_.reserve(postings.sealed.size());
+	for (const SegmentedPostings::Part& part : postings.sealed) {
+		sealed_.emplace_back(*part.postings);
+		part_ends_.push_back(part.last_ordinal);
+	}
+	ordinal_ = sealed_.empty() ? tail_.GetOrdinal() : sealed_.front().GetOrdinal();
+	if (ordinal_ == END && !sealed_.empty()) {
+		MoveToNextPart();
+	}
+}
+
+void SegmentedPostingCursor::SkipTo(DocumentOrdinal ordinal) {
+	if (ordinal <= ordinal_) {
+		return;
+	}
+	// whole segments that end before ordinal are passed without being touched
+	while (part_ < sealed_.size() && part_ends_[part_] <= ordinal) {
+		++part_;
+	}
+	if (part_ == sealed_.size()) {
+		tail_.SkipTo(ordinal);
+		ordinal_ = tail_.GetOrdinal();
+		return;
+	}
+	sealed_[part_].SkipTo(ordinal);
+	ordinal_ = sealed_[part_].GetOrdinal();
+	if (ordinal_ == END) {
+		MoveToNextPart();
+	}
+}
+
+double SegmentedPostingCursor::GetBlockMaxTermFreqAt(DocumentOrdinal ordinal) {
+	shallow_part_ = std::max(shallow_part_, part_);
+	while (shallow_part_ < sealed_.size() && part_ends_[shallow_part_] <= ordinal) {
+		++shallow_part_;
+	}
+	return shallow_part_ < sealed_.size()
+		? sealed_[shallow_part_].GetBlockMaxTermFreqAt(ordinal)
+		: tail_.GetBlockMaxTermFreqAt(ordinal);
+}
+
+double SegmentedPostingCursor::GetMaxTermFreqIn(DocumentOrdinal first, DocumentOrdinal last) {
+	shallow_part_ = std::max(shallow_part_, part_);
+	while (shallow_part_ < sealed_.size() && part_ends_[shallow_part_] <= first) {
+		++shallow_part_;
+	}
+	// the range may go on into the following segments and the tail
+	double max_term_freq = 0.0;
+	for (size_t part = shallow_part_; part < sealed_.size(); ++part) {
+		const DocumentOrdinal part_first = part == shallow_part_ ? first : part_ends_[part - 1];
+		max_term_freq = std::max(max_term_freq, sealed_[part].GetMaxTermFreqIn(part_first, last));
+		if (part_ends_[part] > last) {
+			return max_term_freq;
+		}
+	}
+	const DocumentOrdinal tail_first = shallow_part_ < sealed_.size() ? part_ends_.back() : first;
+	return std::max(max_term_freq, tail_.GetMaxTermFreqIn(tail_first, last));
+}
+
+void SegmentedPostingCursor::MoveToNextPart() {
+	// called when the current sealed part is exhausted
+	while (++part_ < sealed_.size()) {
+		ordinal_ = sealed_[part_].GetOrdinal();
+		if (ordinal_ != END) {
+			return;
+		}
+	}
+	ordinal_ = tail_.GetOrdinal();
+}
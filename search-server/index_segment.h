@@ -0,0 +1,123 @@
+#pragma once
+
+#include "compressed_posting_list.h"
+#include "posting_list.h"
+#include "term_dictionary.h"
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Immutable part of the index: compressed postings of the ordinals
+// [first_ordinal, last_ordinal). Once built a segment is only read, so it is
+// shared between server copies and read by background merges without locks.
+class IndexSegment {
+public:
+	// postings are indexed by TermId and must lie in the ordinal range,
+	// codebook must hold every term_freq of them
+	IndexSegment(DocumentOrdinal first_ordinal, DocumentOrdinal last_ordinal, const std::vector<PostingList>& postings,
+		std::shared_ptr<const TermFreqCodebook> codebook);
+
+	DocumentOrdinal GetFirstOrdinal() const;
+
+	DocumentOrdinal GetLastOrdinal() const;
+
+	// nullptr when the segment holds no postings of the term
+	const CompressedPostingList* FindPostings(TermId term_id) const;
+
+	const TermFreqCodebook& GetCodebook() const;
+
+	size_t GetTermCount() const;
+
+	size_t GetPostingCount() const;
+
+	size_t GetMemoryUsage() const;
+
+private:
+	DocumentOrdinal first_ordinal_;
+	DocumentOrdinal last_ordinal_;
+	std::shared_ptr<const TermFreqCodebook> codebook_;
+	std::vector<CompressedPostingList> postings_;
+	size_t posting_count_ = 0;
+};
+
+// Seals flat posting lists of the ordinals [first_ordinal, last_ordinal) into a segment,
+// leaving out the ordinals marked in is_removed
+std::shared_ptr<const IndexSegment> SealSegment(const std::vector<PostingList>& postings,
+	DocumentOrdinal first_ordinal, DocumentOrdinal last_ordinal, const std::vector<bool>& is_removed);
+
+// Merges consecutive segments into one, leaving out the ordinals marked in is_removed.
+// Non-empty new_ordinals renumbers the remaining ones; it must keep their order.
+std::shared_ptr<const IndexSegment> MergeSegments(const std::vector<std::shared_ptr<const IndexSegment>>& segments,
+	const std::vector<bool>& is_removed, const std::vector<DocumentOrdinal>& new_ordinals);
+
+// Postings of one term: its lists in consecutive sealed segments, then the mutable tail
+struct SegmentedPostings {
+	struct Part {
+		const CompressedPostingList* postings;
+		// end of the ordinal range of the part's segment
+		DocumentOrdinal last_ordinal;
+	};
+
+	std::vector<Part> sealed;
+	const PostingList* tail = nullptr;
+
+	double GetMaxTermFreq() const;
+};
+
+// Same interface as PostingCursor over all parts of SegmentedPostings
+class SegmentedPostingCursor {
+public:
+	static constexpr DocumentOrdinal END = PostingCursor::END;
+
+	explicit SegmentedPostingCursor(const SegmentedPostings& postings);
+
+	bool IsEnd() const {
+		return ordinal_ == END;
+	}
+
+	DocumentOrdinal GetOrdinal() const {
+		return ordinal_;
+	}
+
+	double GetTermFreq() const {
+		return part_ < sealed_.size() ? sealed_[part_].GetTermFreq() : tail_.GetTermFreq();
+	}
+
+	void Next() {
+		if (part_ < sealed_.size()) {
+			sealed_[part_].Next();
+			ordinal_ = sealed_[part_].GetOrdinal();
+			if (ordinal_ == END) {
+				MoveToNextPart();
+			}
+		}
+		else {
+			tail_.Next();
+			ordinal_ = tail_.GetOrdinal();
+		}
+	}
+
+	void SkipTo(DocumentOrdinal ordinal);
+
+	double GetMaxTermFreq() const {
+		return max_term_freq_;
+	}
+
+	// bound of the block that would hold ordinal; requests must not decrease
+	double GetBlockMaxTermFreqAt(DocumentOrdinal ordinal);
+
+	// bound of the blocks that would hold the ordinals [first, last], the same way
+	double GetMaxTermFreqIn(DocumentOrdinal first, DocumentOrdinal last);
+
+private:
+	std::vector<CompressedPostingList::Cursor> sealed_;
+	std::vector<DocumentOrdinal> part_ends_;
+	PostingCursor tail_;
+	size_t part_ = 0;
+	size_t shallow_part_ = 0;
+	DocumentOrdinal ordinal_ = END;
+	double max_term_freq_ = 0.0;
+
+	void MoveToNextPart();
+};
@@ -0,0 +1,482 @@
+#include "index_snapshot.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	using namespace std::string_literals;
+
+	const char SNAPSHOT_MAGIC[8] = { 'S', 'R', 'C', 'H', 'I', 'D', 'X', '\0' };
+	// written as is, so a file from a machine with another byte order does not match
+	const uint32_t BYTE_ORDER_MARK = 0x01020304;
+	const size_t SECTION_ALIGNMENT = 8;
+
+	enum Section {
+		STOP_WORD_OFFSETS,
+		STOP_WORD_CHARS,
+		TERM_OFFSETS,
+		TERM_CHARS,
+		POSTING_OFFSETS,
+		POSTING_ORDINALS,
+		POSTING_TERM_FREQS,
+		DOCUMENTS,
+		DOCUMENT_IDS,
+		TEXT_OFFSETS,
+		TEXT_CHARS,
+		SECTION_COUNT,
+	};
+
+	struct SnapshotHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t byte_order;
+		uint64_t file_size;
+		uint64_t stop_word_count;
+		uint64_t term_count;
+		uint64_t posting_count;
+		uint64_t document_count;
+		uint64_t max_result_document_count;
+		uint64_t section_offsets[SECTION_COUNT];
+		uint64_t section_sizes[SECTION_COUNT];
+	};
+
+	using DocumentId = IndexSnapshotData::DocumentId;
+
+	struct SectionBytes {
+		const void* data;
+		size_t size;
+	};
+
+	template <typename T>
+	SectionBytes AsBytes(const std::vector<T>& values) {
+		return { values.data(), values.size() * sizeof(T) };
+	}
+
+	void AppendStringTable(const std::vector<std::string_view>& strings, std::vector<uint64_t>& offsets, std::string& chars) {
+		offsets.push_back(0);
+		for (std::string_view string : strings) {
+			chars += string;
+			offsets.push_back(chars.size());
+		}
+	}
+
+	size_t AlignSection(size_t offset) {
+		return (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+	}
+
+	// the section as an array of count items; its size is divided rather than the count
+	// multiplied, so a count from a crafted header cannot overflow into a match
+	template <typename T>
+	const T* GetSection(const std::string& path, const MappedFile& file, const SnapshotHeader& header, Section section, uint64_t count) {
+		const uint64_t size = header.section_sizes[section];
+		if (size % sizeof(T) != 0 || size / sizeof(T) != count) {
+			throw std::runtime_error("Index snapshot "s + path + " is corrupted: section "s + std::to_string(section) + " has a wrong size"s);
+		}
+		return reinterpret_cast<const T*>(file.data() + header.section_offsets[section]);
+	}
+
+	// the count + 1 offsets of a table of count strings
+	const uint64_t* GetOffsetsSection(const std::string& path, const MappedFile& file, const SnapshotHeader& header, Section section,
+		uint64_t count) {
+		if (count == std::numeric_limits<uint64_t>::max()) {
+			throw std::runtime_error("Index snapshot "s + path + " is corrupted: section "s + std::to_string(section) + " has a wrong size"s);
+		}
+		return GetSection<uint64_t>(path, file, header, section, count + 1);
+	}
+
+	// offsets of count items that start at 0 and end at limit without going back
+	bool AreOffsetsValid(const uint64_t* offsets, size_t count, uint64_t limit) {
+		return offsets[0] == 0 && offsets[count] == limit && std::is_sorted(offsets, offsets + count + 1);
+	}
+}
+
+void WriteIndexSnapshot(const std::string& path, const IndexSnapshotData& data) {
+	std::vector<uint64_t> stop_word_offsets, term_offsets, text_offsets;
+	std::string stop_word_chars, term_chars, text_chars;
+	AppendStringTable(data.stop_words, stop_word_offsets, stop_word_chars);
+	AppendStringTable(data.terms, term_offsets, term_chars);
+	AppendStringTable(data.texts, text_offsets, text_chars);
+
+	std::vector<DocumentId> document_ids;
+	document_ids.reserve(data.documents.size());
+	for (size_t ordinal = 0; ordinal < data.documents.size(); ++ordinal) {
+		document_ids.push_back({ data.documents[ordinal].id, static_cast<DocumentOrdinal>(ordinal) });
+	}
+	std::sort(document_ids.begin(), document_ids.end(), [](const DocumentId& lhs, const DocumentId& rhs) {
+		return lhs.id < rhs.id;
+	});
+
+	SectionBytes sections[SECTION_COUNT];
+	sections[STOP_WORD_OFFSETS] = AsBytes(stop_word_offsets);
+	sections[STOP_WORD_CHARS] = { stop_word_chars.data(), stop_word_chars.size() };
+	sections[TERM_OFFSETS] = AsBytes(term_offsets);
+	sections[TERM_CHARS] = { term_chars.data(), term_chars.size() };
+	sections[POSTING_OFFSETS] = AsBytes(data.posting_offsets);
+	sections[POSTING_ORDINALS] = AsBytes(data.ordinals);
+	sections[POSTING_TERM_FREQS] = AsBytes(data.term_freqs);
+	sections[DOCUMENTS] = AsBytes(data.documents);
+	sections[DOCUMENT_IDS] = AsBytes(document_ids);
+	sections[TEXT_OFFSETS] = AsBytes(text_offsets);
+	sections[TEXT_CHARS] = { text_chars.data(), text_chars.size() };
+
+	SnapshotHeader header = {};
+	std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+	header.version = INDEX_SNAPSHOT_VERSION;
+	header.byte_order = BYTE_ORDER_MARK;
+	header.stop_word_count = data.stop_words.size();
+	header.term_count = data.terms.size();
+	header.posting_count = data.ordinals.size();
+	header.document_count = data.documents.size();
+	header.max_result_document_count = data.max_result_document_count;
+	size_t offset = sizeof(SnapshotHeader);
+	for (int section = 0; section < SECTION_COUNT; ++section) {
+		offset = AlignSection(offset);
+		header.section_offsets[section] = offset;
+		header.section_sizes[section] = sections[section].size;
+		offset += sections[section].size;
+	}
+	header.file_size = offset;
+
+	std::ofstream output(path, std::ios::binary | std::ios::trunc);
+	if (!output) {
+		throw std::runtime_error("Cannot create index snapshot "s + path);
+	}
+	output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	const char padding[SECTION_ALIGNMENT] = {};
+	size_t written = sizeof(header);
+	for (int section = 0; section < SECTION_COUNT; ++section) {
+		output.write(padding, header.section_offsets[section] - written);
+		output.write(static_cast<const char*>(sections[section].data), sections[section].size);
+		written = header.section_offsets[section] + sections[section].size;
+	}
+	if (!output.flush()) {
+		throw std::runtime_error("Cannot write index snapshot "s + path);
+	}
+}
+
+MappedFile::MappedFile(const std::string& path) {
+#ifdef _WIN32
+	const HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("Cannot open "s + path);
+	}
+	LARGE_INTEGER file_size;
+	GetFileSizeEx(file, &file_size);
+	size_ = static_cast<size_t>(file_size.QuadPart);
+	const HANDLE mapping = size_ > 0 ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+	CloseHandle(file);
+	if (mapping != nullptr) {
+		data_ = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		CloseHandle(mapping);
+	}
+	if (size_ > 0 && data_ == nullptr) {
+		throw std::runtime_error("Cannot map "s + path);
+	}
+#else
+	const int descriptor = open(path.c_str(), O_RDONLY);
+	if (descriptor < 0) {
+		throw std::runtime_error("Cannot open "s + path);
+	}
+	struct stat file_stat;
+	if (fstat(descriptor, &file_stat) != 0) {
+		close(descriptor);
+		throw std::runtime_error("Cannot open "s + path);
+	}
+	size_ = static_cast<size_t>(file_stat.st_size);
+	if (size_ > 0) {
+		void* data = mmap(nullptr, size_, PROT_READ, MAP_SHARED, descriptor, 0);
+		if (data == MAP_FAILED) {
+			close(descriptor);
+			throw std::runtime_error("Cannot map "s + path);
+		}
+		data_ = static_cast<const char*>(data);
+	}
+	close(descriptor);
+#endif
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+	: data_(other.data_), size_(other.size_) {
+	other.data_ = nullptr;
+	other.size_ = 0;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+	if (this != &other) {
+		Unmap();
+		std::swap(data_, other.data_);
+		std::swap(size_, other.size_);
+	}
+	return *this;
+}
+
+MappedFile::~MappedFile() {
+	Unmap();
+}
+
+const char* MappedFile::data() const {
+	return data_;
+}
+
+size_t MappedFile::size() const {
+	return size_;
+}
+
+void MappedFile::Unmap() {
+	if (data_ != nullptr) {
+#ifdef _WIN32
+		UnmapViewOfFile(data_);
+#else
+		munmap(const_cast<char*>(data_), size_);
+#endif
+	}
+	data_ = nullptr;
+	size_ = 0;
+}
+
+MappedSearchServer::MappedSearchServer(const std::string& path)
+	: path_(path), file_(path) {
+	if (file_.size() < sizeof(SnapshotHeader)) {
+		throw std::runtime_error("Index snapshot "s + path + " is truncated"s);
+	}
+	SnapshotHeader header;
+	std::memcpy(&header, file_.data(), sizeof(header));
+	if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 || header.byte_order != BYTE_ORDER_MARK) {
+		throw std::runtime_error(path + " is not an index snapshot"s);
+	}
+	if (header.version != INDEX_SNAPSHOT_VERSION) {
+		throw std::runtime_error("Unsupported index snapshot version "s + std::to_string(header.version));
+	}
+	if (header.file_size != file_.size()) {
+		throw std::runtime_error("Index snapshot "s + path + " is truncated"s);
+	}
+	for (int section = 0; section < SECTION_COUNT; ++section) {
+		if (header.section_offsets[section] % SECTION_ALIGNMENT != 0
+			|| header.section_offsets[section] > file_.size()
+			|| header.section_sizes[section] > file_.size() - header.section_offsets[section]) {
+			throw std::runtime_error("Index snapshot "s + path + " is corrupted"s);
+		}
+	}
+
+	max_result_document_count_ = static_cast<size_t>(header.max_result_document_count);
+	// the stop words are hashed here anyway, so their table is checked in full
+	StringTable stop_words;
+	stop_words.offsets = GetOffsetsSection(path, file_, header, STOP_WORD_OFFSETS, header.stop_word_count);
+	stop_words.size = static_cast<size_t>(header.stop_word_count);
+	stop_words.char_count = stop_words.offsets[stop_words.size];
+	stop_words.chars = GetSection<char>(path, file_, header, STOP_WORD_CHARS, stop_words.char_count);
+	if (!AreOffsetsValid(stop_words.offsets, stop_words.size, stop_words.char_count)) {
+		ThrowCorrupted("stop word offsets are out of order"s);
+	}
+	std::vector<std::string_view> stop_word_list(stop_words.size);
+	for (size_t i = 0; i < stop_words.size; ++i) {
+		stop_word_list[i] = stop_words[i];
+	}
+	stop_words_ = FrozenWordSet(std::move(stop_word_list));
+
+	terms_.offsets = GetOffsetsSection(path, file_, header, TERM_OFFSETS, header.term_count);
+	terms_.size = static_cast<size_t>(header.term_count);
+	terms_.char_count = terms_.offsets[terms_.size];
+	terms_.chars = GetSection<char>(path, file_, header, TERM_CHARS, terms_.char_count);
+	posting_offsets_ = GetOffsetsSection(path, file_, header, POSTING_OFFSETS, header.term_count);
+	ordinals_ = GetSection<DocumentOrdinal>(path, file_, header, POSTING_ORDINALS, header.posting_count);
+	term_freqs_ = GetSection<double>(path, file_, header, POSTING_TERM_FREQS, header.posting_count);
+	posting_count_ = static_cast<size_t>(header.posting_count);
+	documents_ = GetSection<IndexSnapshotData::DocumentRecord>(path, file_, header, DOCUMENTS, header.document_count);
+	document_ids_ = GetSection<DocumentId>(path, file_, header, DOCUMENT_IDS, header.document_count);
+	document_count_ = static_cast<size_t>(header.document_count);
+	texts_.offsets = GetOffsetsSection(path, file_, header, TEXT_OFFSETS, header.document_count);
+	texts_.size = document_count_;
+	texts_.char_count = texts_.offsets[texts_.size];
+	texts_.chars = GetSection<char>(path, file_, header, TEXT_CHARS, texts_.char_count);
+}
+
+void MappedSearchServer::Verify() const {
+	if (!AreOffsetsValid(terms_.offsets, terms_.size, terms_.char_count)) {
+		ThrowCorrupted("term offsets are out of order"s);
+	}
+	// lookups binary search the terms
+	for (size_t term = 1; term < terms_.size; ++term) {
+		if (terms_[term - 1] >= terms_[term]) {
+			ThrowCorrupted("terms are out of order"s);
+		}
+	}
+	if (!AreOffsetsValid(texts_.offsets, texts_.size, texts_.char_count)) {
+		ThrowCorrupted("text offsets are out of order"s);
+	}
+	if (!AreOffsetsValid(posting_offsets_, terms_.size, posting_count_)) {
+		ThrowCorrupted("posting offsets are out of order"s);
+	}
+	// lookups merge and binary search the postings of a term, so they must be sorted too
+	for (size_t term = 0; term < terms_.size; ++term) {
+		for (uint64_t i = posting_offsets_[term]; i < posting_offsets_[term + 1]; ++i) {
+			if (ordinals_[i] >= document_count_) {
+				ThrowCorrupted("posting ordinal "s + std::to_string(ordinals_[i]) + " is out of range"s);
+			}
+			if (i > posting_offsets_[term] && ordinals_[i - 1] >= ordinals_[i]) {
+				ThrowCorrupted("postings of term "s + std::string(terms_[term]) + " are out of order"s);
+			}
+		}
+	}
+	for (size_t i = 0; i < document_count_; ++i) {
+		if (document_ids_[i].ordinal >= document_count_) {
+			ThrowCorrupted("document ordinal "s + std::to_string(document_ids_[i].ordinal) + " is out of range"s);
+		}
+		if (i > 0 && document_ids_[i - 1].id >= document_ids_[i].id) {
+			ThrowCorrupted("document ids are out of order"s);
+		}
+	}
+}
+
+void MappedSearchServer::ThrowCorrupted(const std::string& reason) const {
+	throw std::runtime_error("Index snapshot "s + path_ + " is corrupted: "s + reason);
+}
+
+std::vector<Document> MappedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
+	return FindTopDocuments(raw_query, status, max_result_document_count_);
+}
+
+std::vector<Document> MappedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status, size_t document_count) const {
+	return FindTopDocuments(raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
+		return document_status == status;
+		}, document_count);
+}
+
+MappedSearchServer::MatchDocumentResult MappedSearchServer::MatchDocument(std::string_view raw_query, int document_id) const {
+	const DocumentId* document = FindDocument(document_id);
+	if (document == nullptr) {
+		throw std::out_of_range("incorrect document id"s);
+	}
+	const Query query = ParseQuery(raw_query);
+	const auto status = static_cast<DocumentStatus>(documents_[document->ordinal].status);
+	const auto contains = [this, ordinal = document->ordinal](std::string_view word) {
+		const PostingRange postings = FindPostings(word);
+		return std::binary_search(postings.ordinals, postings.ordinals + postings.size, ordinal);
+	};
+	for (std::string_view word : query.minus_words) {
+		if (contains(word)) {
+			return { std::vector<std::string_view>{}, status };
+		}
+	}
+	std::vector<std::string_view> matched_words;
+	for (std::string_view word : query.plus_words) {
+		if (contains(word)) {
+			matched_words.push_back(word);
+		}
+	}
+	return { matched_words, status };
+}
+
+size_t MappedSearchServer::GetMaxResultDocumentCount() const {
+	return max_result_document_count_;
+}
+
+int MappedSearchServer::GetDocumentCount() const {
+	return static_cast<int>(document_count_);
+}
+
+int MappedSearchServer::GetDocumentId(int index) const {
+	if (index < 0 || index >= GetDocumentCount()) {
+		throw std::out_of_range("Invalid document index"s);
+	}
+	return documents_[index].id;
+}
+
+std::string_view MappedSearchServer::GetDocumentText(int document_id) const {
+	const DocumentId* document = FindDocument(document_id);
+	if (document == nullptr) {
+		throw std::out_of_range("incorrect document id"s);
+	}
+	return texts_[document->ordinal];
+}
+
+std::string_view MappedSearchServer::StringTable::operator[](size_t index) const {
+	const uint64_t first = offsets[index];
+	const uint64_t last = offsets[index + 1];
+	if (first > last || last > char_count) {
+		throw std::runtime_error("Index snapshot is corrupted: string offsets are out of range"s);
+	}
+	return { chars + first, static_cast<size_t>(last - first) };
+}
+
+size_t MappedSearchServer::StringTable::Find(std::string_view word) const {
+	size_t first = 0;
+	size_t last = size;
+	while (first < last) {
+		const size_t middle = first + (last - first) / 2;
+		if ((*this)[middle] < word) {
+			first = middle + 1;
+		}
+		else {
+			last = middle;
+		}
+	}
+	return first < size && (*this)[first] == word ? first : size;
+}
+
+MappedSearchServer::Query MappedSearchServer::ParseQuery(std::string_view text) const {
+	// the rules of SearchServer::ParseQuery
+	Query result;
+	ForEachWord(text, [this, &result](std::string_view word, bool is_valid) {
+		if (word.empty()) {
+			throw std::invalid_argument("Query word is empty"s);
+		}
+		std::string_view data = word;
+		const bool is_minus = data[0] == '-';
+		if (is_minus) {
+			data = data.substr(1);
+		}
+		if (data.empty() || data[0] == '-' || !is_valid) {
+			throw std::invalid_argument("Query word "s + std::string(word) + " is invalid"s);
+		}
+		if (!stop_words_.Contains(data)) {
+			(is_minus ? result.minus_words : result.plus_words).push_back(data);
+		}
+		});
+
+	for (auto* words : { &result.plus_words, &result.minus_words }) {
+		std::sort(words->begin(), words->end());
+		words->erase(std::unique(words->begin(), words->end()), words->end());
+	}
+	return result;
+}
+
+MappedSearchServer::PostingRange MappedSearchServer::FindPostings(std::string_view word) const {
+	const size_t term = terms_.Find(word);
+	if (term == terms_.size) {
+		return { nullptr, nullptr, 0 };
+	}
+	const uint64_t first = posting_offsets_[term];
+	const uint64_t last = posting_offsets_[term + 1];
+	if (first > last || last > posting_count_) {
+		ThrowCorrupted("posting offsets of term "s + std::string(word) + " are out of range"s);
+	}
+	return { ordinals_ + first, term_freqs_ + first, static_cast<size_t>(last - first) };
+}
+
+const MappedSearchServer::DocumentId* MappedSearchServer::FindDocument(int document_id) const {
+	const DocumentId* last = document_ids_ + document_count_;
+	const DocumentId* it = std::lower_bound(document_ids_, last, document_id, [](const DocumentId& document, int id) {
+		return document.id < id;
+	});
+	if (it == last || it->id != document_id) {
+		return nullptr;
+	}
+	if (it->ordinal >= document_count_) {
+		ThrowCorrupted("document ordinal "s + std::to_string(it->ordinal) + " is out of range"s);
+	}
+	return it;
+}
@@ -0,0 +1,227 @@
+#pragma once
+
+#include "document.h"
+#include "perfect_hash.h"
+#include "posting_list.h"
+#include "search_server.h"
+#include "top_documents.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <execution>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+// bumped on every change of the file layout, older files are rejected
+const uint32_t INDEX_SNAPSHOT_VERSION = 2;
+
+// Contents of an index snapshot as SearchServer::SaveSnapshot collects them.
+// Documents get dense ordinals, terms are sorted and postings of term i are
+// ordinals[posting_offsets[i]..posting_offsets[i + 1]), sorted by ordinal.
+struct IndexSnapshotData {
+	struct DocumentRecord {
+		int32_t id;
+		int32_t rating;
+		int32_t status;
+	};
+
+	struct DocumentId {
+		int32_t id;
+		DocumentOrdinal ordinal;
+	};
+
+	std::vector<std::string_view> stop_words;
+	std::vector<std::string_view> terms;
+	std::vector<uint64_t> posting_offsets;
+	std::vector<DocumentOrdinal> ordinals;
+	std::vector<double> term_freqs;
+	std::vector<DocumentRecord> documents;
+	std::vector<std::string_view> texts;
+	uint64_t max_result_document_count = MAX_RESULT_DOCUMENT_COUNT;
+};
+
+// Writes a snapshot file: a header followed by 8-byte aligned flat arrays in
+// native byte order, laid out so that a mapping of the file can be read in place
+void WriteIndexSnapshot(const std::string& path, const IndexSnapshotData& data);
+
+// Read-only view of a whole file mapped into memory
+class MappedFile {
+public:
+	explicit MappedFile(const std::string& path);
+
+	MappedFile(const MappedFile&) = delete;
+
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	MappedFile(MappedFile&& other) noexcept;
+
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	~MappedFile();
+
+	const char* data() const;
+
+	size_t size() const;
+
+private:
+	const char* data_ = nullptr;
+	size_t size_ = 0;
+
+	void Unmap();
+};
+
+// Search server over a memory-mapped snapshot. Opening checks only the header and the
+// sizes of the sections, so it takes the same time for any index; lookups read the mapped
+// arrays directly and bound-check every offset and ordinal they follow, so the pages are
+// loaded on first use and shared through the page cache. Results are the same as the
+// sequential searches of the SearchServer the snapshot was saved from, with its default
+// number of results.
+class MappedSearchServer {
+public:
+	explicit MappedSearchServer(const std::string& path);
+
+	template <typename DocumentPredicate>
+	std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const;
+
+	template <typename DocumentPredicate>
+	std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+		size_t document_count) const;
+
+	std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL) const;
+
+	std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status, size_t document_count) const;
+
+	using MatchDocumentResult = std::tuple<std::vector<std::string_view>, DocumentStatus>;
+
+	MatchDocumentResult MatchDocument(std::string_view raw_query, int document_id) const;
+
+	int GetDocumentCount() const;
+
+	int GetDocumentId(int index) const;
+
+	std::string_view GetDocumentText(int document_id) const;
+
+	size_t GetMaxResultDocumentCount() const;
+
+	// Reads the whole file and throws on the first table out of order or ordinal out of
+	// range. Lookups into such a file never read outside of it, but may miss matches.
+	void Verify() const;
+
+private:
+	using DocumentId = IndexSnapshotData::DocumentId;
+
+	struct StringTable {
+		const uint64_t* offsets = nullptr;
+		const char* chars = nullptr;
+		size_t size = 0;
+		uint64_t char_count = 0;
+
+		// throws when the offsets of the string point outside of the chars
+		std::string_view operator[](size_t index) const;
+
+		// index of word in a sorted table, or size when it is absent
+		size_t Find(std::string_view word) const;
+	};
+
+	struct PostingRange {
+		const DocumentOrdinal* ordinals;
+		const double* term_freqs;
+		size_t size;
+	};
+
+	struct Query {
+		std::vector<std::string_view> plus_words;
+		std::vector<std::string_view> minus_words;
+	};
+
+	struct Accumulator {
+		DocumentOrdinal ordinal;
+		double relevance;
+	};
+
+	std::string path_;
+	MappedFile file_;
+	// hashed on load, the table in the file is sorted
+	FrozenWordSet stop_words_;
+	StringTable terms_;
+	const uint64_t* posting_offsets_ = nullptr;
+	size_t posting_count_ = 0;
+	const DocumentOrdinal* ordinals_ = nullptr;
+	const double* term_freqs_ = nullptr;
+	const IndexSnapshotData::DocumentRecord* documents_ = nullptr;
+	// sorted by id
+	const DocumentId* document_ids_ = nullptr;
+	StringTable texts_;
+	size_t document_count_ = 0;
+	size_t max_result_document_count_ = MAX_RESULT_DOCUMENT_COUNT;
+
+	[[noreturn]] void ThrowCorrupted(const std::string& reason) const;
+
+	Query ParseQuery(std::string_view text) const;
+
+	PostingRange FindPostings(std::string_view word) const;
+
+	const DocumentId* FindDocument(int document_id) const;
+};
+
+template <typename DocumentPredicate>
+std::vector<Document> MappedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const {
+	return FindTopDocuments(raw_query, document_predicate, max_result_document_count_);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> MappedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+	size_t document_count) const {
+	// The same arithmetic in the same order as SearchServer::FindAllDocuments. Postings are
+	// sorted by ordinal, so the matched documents are merged into a list sorted the same way
+	// and a query costs its postings, not the size of the index.
+	const Query query = ParseQuery(raw_query);
+	std::vector<Accumulator> accumulators;
+	std::vector<Accumulator> merged;
+	for (std::string_view word : query.plus_words) {
+		const PostingRange postings = FindPostings(word);
+		if (postings.size == 0) {
+			continue;
+		}
+		const double inverse_document_freq = std::log(GetDocumentCount() * 1.0 / postings.size);
+		merged.clear();
+		merged.reserve(accumulators.size() + postings.size);
+		auto it = accumulators.begin();
+		for (size_t i = 0; i < postings.size; ++i) {
+			const DocumentOrdinal ordinal = postings.ordinals[i];
+			if (ordinal >= document_count_) {
+				ThrowCorrupted("posting ordinal " + std::to_string(ordinal) + " is out of range");
+			}
+			for (; it != accumulators.end() && it->ordinal < ordinal; ++it) {
+				merged.push_back(*it);
+			}
+			const auto& document = documents_[ordinal];
+			if (document_predicate(document.id, static_cast<DocumentStatus>(document.status), document.rating)) {
+				const double relevance = it != accumulators.end() && it->ordinal == ordinal ? (it++)->relevance : 0.0;
+				merged.push_back({ ordinal, relevance + postings.term_freqs[i] * inverse_document_freq });
+			}
+		}
+		merged.insert(merged.end(), it, accumulators.end());
+		accumulators.swap(merged);
+	}
+	for (std::string_view word : query.minus_words) {
+		const PostingRange postings = FindPostings(word);
+		const DocumentOrdinal* first = postings.ordinals;
+		const DocumentOrdinal* last = postings.ordinals + postings.size;
+		accumulators.erase(std::remove_if(accumulators.begin(), accumulators.end(), [&first, last](const Accumulator& accumulator) {
+			first = std::lower_bound(first, last, accumulator.ordinal);
+			return first != last && *first == accumulator.ordinal;
+			}), accumulators.end());
+	}
+
+	std::vector<Document> matched_documents;
+	matched_documents.reserve(accumulators.size());
+	for (const auto& [ordinal, relevance] : accumulators) {
+		matched_documents.push_back({ documents_[ordinal].id, relevance, documents_[ordinal].rating });
+	}
+	return SelectTopDocuments(std::execution::seq, matched_documents, document_count);
+}
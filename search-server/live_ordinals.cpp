@@ -0,0 +1,57 @@
+#include "live_ordinals.h"
+
+namespace {
+
+size_t LowBit(size_t i) {
+	return i & (~i + 1);
+}
+
+}  // namespace
+
+void LiveOrdinals::PushBack() {
+	const size_t i = tree_.size();
+	// the node covers i - lowbit(i) .. i - 1, the last of them the new one
+	tree_.push_back(1 + GetPrefixCount(i - 1) - GetPrefixCount(i - LowBit(i)));
+}
+
+void LiveOrdinals::Remove(DocumentOrdinal ordinal) {
+	for (size_t i = ordinal + size_t{ 1 }; i < tree_.size(); i += LowBit(i)) {
+		--tree_[i];
+	}
+}
+
+void LiveOrdinals::Assign(const std::vector<bool>& is_live) {
+	tree_.assign(is_live.size() + 1, 0);
+	for (size_t i = 1; i < tree_.size(); ++i) {
+		tree_[i] += is_live[i - 1] ? 1 : 0;
+		const size_t parent = i + LowBit(i);
+		if (parent < tree_.size()) {
+			tree_[parent] += tree_[i];
+		}
+	}
+}
+
+DocumentOrdinal LiveOrdinals::Select(size_t index) const {
+	size_t step = 1;
+	while (step * 2 < tree_.size()) {
+		step *= 2;
+	}
+	// the largest position whose prefix holds at most index live ordinals
+	size_t position = 0;
+	size_t remaining = index;
+	for (; step > 0; step /= 2) {
+		if (position + step < tree_.size() && tree_[position + step] <= remaining) {
+			position += step;
+			remaining -= tree_[position];
+		}
+	}
+	return static_cast<DocumentOrdinal>(position);
+}
+
+uint32_t LiveOrdinals::GetPrefixCount(size_t count) const {
+	uint32_t result = 0;
+	for (size_t i = count; i > 0; i -= LowBit(i)) {
+		result += tree_[i];
+	}
+	return result;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "posting_list.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Which ordinals hold live documents, as a Fenwick tree of their counts: the index-th
+// live ordinal is found, and a removal recorded, in O(log N) without shifting anything.
+class LiveOrdinals {
+public:
+	// the next ordinal, live
+	void PushBack();
+
+	void Remove(DocumentOrdinal ordinal);
+
+	// after a renumbering; is_live is indexed by the new ordinals
+	void Assign(const std::vector<bool>& is_live);
+
+	// ordinal of the index-th live document, index below the number of live documents
+	DocumentOrdinal Select(size_t index) const;
+
+private:
+	// tree_[i] counts the live ordinals in [i - lowbit(i), i), 1-based
+	std::vector<uint32_t> tree_ = { 0 };
+
+	uint32_t GetPrefixCount(size_t count) const;
+};
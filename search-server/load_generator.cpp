@@ -0,0 +1,350 @@
+#include "concurrent_search_server.h"
+#include "corpus_generator.h"
+#include "process_queries.h"
+#include "query_telemetry.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace std::literals;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const int DOCUMENT_WORD_COUNT = 70;
+const int MAX_WORD_LENGTH = 10;
+const size_t LOAD_BATCH_SIZE = 1024;
+
+struct LoadOptions {
+	int document_count = 10'000;
+	int vocabulary_size = 1'000;
+	size_t query_thread_count = 4;
+	size_t writer_thread_count = 1;
+	// requests per second over all the query threads, 0 for as many as they manage
+	double query_rate = 0.0;
+	// writes per second over all the writer threads, 0 for as many as they manage
+	double write_rate = 100.0;
+	// share of the writes that remove the oldest document instead of adding one
+	double remove_share = 0.5;
+	size_t distinct_query_count = 10'000;
+	double zipf_exponent = 1.0;
+	int query_word_count = 3;
+	double minus_prob = 0.1;
+	// queries of a ProcessQueries request, 0 for one FindTopDocuments per request
+	size_t batch_size = 0;
+	RankingMode ranking_mode = RankingMode::EXHAUSTIVE;
+	// queries to replay in order instead of the Zipfian ones, one per line
+	std::string query_log_path;
+	std::chrono::seconds duration{ 10 };
+	std::chrono::milliseconds report_interval{ 1000 };
+	uint32_t seed = 20240601;
+};
+
+// Closed-loop pacing of one thread: the k-th request is due at start + k * period and
+// waits for it; a thread behind schedule sends at once. Latencies are taken from the due
+// time, so a stall also counts against the requests that queued up behind it.
+class Pacer {
+public:
+	Pacer(double rate, Clock::time_point start)
+		: period_(rate > 0 ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rate)) : Clock::duration::zero())
+		, next_(start) {
+	}
+
+	// due time of the next request, or now when the thread is not paced
+	Clock::time_point Wait() {
+		if (period_ == Clock::duration::zero()) {
+			return Clock::now();
+		}
+		const Clock::time_point due = next_;
+		next_ += period_;
+		std::this_thread::sleep_until(due);
+		return due;
+	}
+
+private:
+	const Clock::duration period_;
+	Clock::time_point next_;
+};
+
+struct LoadState {
+	ConcurrentSearchServer& server;
+	const std::vector<std::string>& dictionary;
+	const std::vector<std::string>& queries;
+	const LoadOptions& options;
+	QueryTelemetry& query_interval;
+	QueryTelemetry& query_total;
+	QueryTelemetry& write_interval;
+	QueryTelemetry& write_total;
+	std::atomic<bool> is_stopping{ false };
+	std::atomic<size_t> next_replayed{ 0 };
+	std::atomic<int> next_added_id;
+	std::atomic<int> next_removed_id{ 0 };
+};
+
+void RunQueries(LoadState& state, size_t thread_index, Clock::time_point start) {
+	const LoadOptions& options = state.options;
+	std::mt19937 generator(options.seed + 100 + static_cast<uint32_t>(thread_index));
+	const ZipfDistribution zipf(state.queries.size(), options.zipf_exponent);
+	const auto pick_query = [&]() -> const std::string& {
+		if (!options.query_log_path.empty()) {
+			return state.queries[state.next_replayed.fetch_add(1) % state.queries.size()];
+		}
+		return state.queries[zipf(generator)];
+	};
+
+	Pacer pacer(options.query_rate / options.query_thread_count, start);
+	std::vector<std::string> batch;
+	while (!state.is_stopping.load(std::memory_order_relaxed)) {
+		const Clock::time_point due = pacer.Wait();
+		size_t result_count = 0;
+		if (options.batch_size == 0) {
+			result_count = state.server.FindTopDocuments(pick_query()).size();
+		}
+		else {
+			batch.clear();
+			for (size_t i = 0; i < options.batch_size; ++i) {
+				batch.push_back(pick_query());
+			}
+			result_count = state.server.Read([&batch](const SearchServer& search_server) {
+				return ProcessQueriesJoined(search_server, batch).size();
+				});
+		}
+		const Clock::duration latency = Clock::now() - due;
+		state.query_interval.Record(latency, result_count);
+		state.query_total.Record(latency, result_count);
+	}
+}
+
+void RunWrites(LoadState& state, size_t thread_index, Clock::time_point start) {
+	const LoadOptions& options = state.options;
+	std::mt19937 generator(options.seed + 200 + static_cast<uint32_t>(thread_index));
+	Pacer pacer(options.write_rate / options.writer_thread_count, start);
+	while (!state.is_stopping.load(std::memory_order_relaxed)) {
+		const Clock::time_point due = pacer.Wait();
+		// documents are removed in the order they were added, keeping at least half of
+		// the initial number of them
+		const bool is_removal = std::uniform_real_distribution<>(0, 1)(generator) < options.remove_share
+			&& state.next_added_id.load() - state.next_removed_id.load() > options.document_count / 2;
+		if (is_removal) {
+			state.server.RemoveDocument(state.next_removed_id.fetch_add(1));
+		}
+		else {
+			const std::string document = GenerateQuery(generator, state.dictionary, DOCUMENT_WORD_COUNT);
+			state.server.AddDocument(state.next_added_id.fetch_add(1), document, DocumentStatus::ACTUAL, { 1, 2, 3 });
+		}
+		const Clock::duration latency = Clock::now() - due;
+		state.write_interval.Record(latency, 1);
+		state.write_total.Record(latency, 1);
+	}
+}
+
+std::string FormatLatency(std::chrono::nanoseconds latency) {
+	std::ostringstream output;
+	output << std::fixed << std::setprecision(latency < 10ms ? 3 : 1) << latency.count() / 1e6;
+	return output.str();
+}
+
+void PrintHeader() {
+	std::cout << std::setw(8) << "time, s"sv << std::setw(12) << "requests/s"sv << std::setw(10) << "p50, ms"sv
+		<< std::setw(10) << "p99, ms"sv << std::setw(10) << "p999, ms"sv << std::setw(10) << "empty, %"sv
+		<< std::setw(10) << "writes/s"sv << std::setw(10) << "p50, ms"sv << std::setw(10) << "p99, ms"sv
+		<< std::setw(10) << "p999, ms"sv << std::setw(11) << "documents"sv << std::endl;
+}
+
+void PrintLine(const std::string& mark, const QueryTelemetryStats& queries, const QueryTelemetryStats& writes, int document_count) {
+	std::cout << std::setw(8) << mark << std::fixed << std::setprecision(0) << std::setw(12) << queries.queries_per_second
+		<< std::setw(10) << FormatLatency(queries.p50) << std::setw(10) << FormatLatency(queries.p99)
+		<< std::setw(10) << FormatLatency(queries.p999) << std::setprecision(1) << std::setw(10) << queries.no_result_rate * 100
+		<< std::setprecision(0) << std::setw(10) << writes.queries_per_second << std::setw(10) << FormatLatency(writes.p50)
+		<< std::setw(10) << FormatLatency(writes.p99) << std::setw(10) << FormatLatency(writes.p999)
+		<< std::setw(11) << document_count << std::defaultfloat << std::endl;
+}
+
+void PrintUsage() {
+	std::cerr << "Usage: search_server_load [--documents=N] [--vocabulary=N] [--query-threads=N] [--writer-threads=N]\n"
+		"                          [--qps=N] [--write-rate=N] [--remove-share=F] [--distinct-queries=N] [--zipf=S]\n"
+		"                          [--query-words=N] [--minus-prob=F] [--batch=N] [--replay=QUERIES.txt]\n"
+		"                          [--ranking=exhaustive|pruning|impact] [--duration=SECONDS] [--interval-ms=N] [--seed=N]\n"
+		"Queries a ConcurrentSearchServer from query threads while writer threads add and remove\n"
+		"documents, and reports throughput and latency percentiles every interval and for the run.\n"
+		"A rate of 0 runs the threads back to back. With --batch a request is a ProcessQueries batch.\n"sv;
+}
+
+bool ParseOptions(int argc, char* argv[], LoadOptions& options) {
+	try {
+		for (int i = 1; i < argc; ++i) {
+			const std::string_view arg = argv[i];
+			const size_t equals = arg.find('=');
+			if (equals == std::string_view::npos) {
+				return false;
+			}
+			const std::string_view key = arg.substr(0, equals);
+			const std::string value(arg.substr(equals + 1));
+			if (key == "--documents"sv) {
+				options.document_count = std::stoi(value);
+			}
+			else if (key == "--vocabulary"sv) {
+				options.vocabulary_size = std::stoi(value);
+			}
+			else if (key == "--query-threads"sv) {
+				options.query_thread_count = std::stoul(value);
+			}
+			else if (key == "--writer-threads"sv) {
+				options.writer_thread_count = std::stoul(value);
+			}
+			else if (key == "--qps"sv) {
+				options.query_rate = std::stod(value);
+			}
+			else if (key == "--write-rate"sv) {
+				options.write_rate = std::stod(value);
+			}
+			else if (key == "--remove-share"sv) {
+				options.remove_share = std::stod(value);
+			}
+			else if (key == "--distinct-queries"sv) {
+				options.distinct_query_count = std::stoul(value);
+			}
+			else if (key == "--zipf"sv) {
+				options.zipf_exponent = std::stod(value);
+			}
+			else if (key == "--query-words"sv) {
+				options.query_word_count = std::stoi(value);
+			}
+			else if (key == "--minus-prob"sv) {
+				options.minus_prob = std::stod(value);
+			}
+			else if (key == "--batch"sv) {
+				options.batch_size = std::stoul(value);
+			}
+			else if (key == "--ranking"sv) {
+				if (value == "exhaustive"sv) {
+					options.ranking_mode = RankingMode::EXHAUSTIVE;
+				}
+				else if (value == "pruning"sv) {
+					options.ranking_mode = RankingMode::DYNAMIC_PRUNING;
+				}
+				else if (value == "impact"sv) {
+					options.ranking_mode = RankingMode::IMPACT_ORDERED;
+				}
+				else {
+					return false;
+				}
+			}
+			else if (key == "--replay"sv) {
+				options.query_log_path = value;
+			}
+			else if (key == "--duration"sv) {
+				options.duration = std::chrono::seconds(std::stoul(value));
+			}
+			else if (key == "--interval-ms"sv) {
+				options.report_interval = std::chrono::milliseconds(std::stoul(value));
+			}
+			else if (key == "--seed"sv) {
+				options.seed = static_cast<uint32_t>(std::stoul(value));
+			}
+			else {
+				return false;
+			}
+		}
+	}
+	catch (const std::exception&) {
+		return false;
+	}
+	return options.document_count > 0 && options.vocabulary_size > 0 && options.distinct_query_count > 0
+		&& options.report_interval.count() > 0;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+	LoadOptions options;
+	if (!ParseOptions(argc, argv, options)) {
+		PrintUsage();
+		return 2;
+	}
+
+	std::mt19937 generator(options.seed);
+	const std::vector<std::string> dictionary = GenerateDictionary(generator, options.vocabulary_size, MAX_WORD_LENGTH);
+	std::vector<std::string> queries;
+	if (options.query_log_path.empty()) {
+		queries = GenerateQueries(generator, dictionary, static_cast<int>(options.distinct_query_count),
+			options.query_word_count, options.minus_prob);
+	}
+	else {
+		std::ifstream input(options.query_log_path);
+		for (std::string line; std::getline(input, line);) {
+			if (!line.empty()) {
+				queries.push_back(line);
+			}
+		}
+		if (queries.empty()) {
+			std::cerr << "No queries in "sv << options.query_log_path << std::endl;
+			return 2;
+		}
+	}
+
+	ConcurrentSearchServer server(dictionary[0]);
+	server.SetRankingMode(options.ranking_mode);
+	std::vector<NewDocument> batch;
+	std::vector<std::string> texts = GenerateQueries(generator, dictionary, options.document_count, DOCUMENT_WORD_COUNT);
+	for (int id = 0; id < options.document_count; ++id) {
+		batch.push_back({ id, texts[id], DocumentStatus::ACTUAL, { 1, 2, 3 } });
+		if (batch.size() == LOAD_BATCH_SIZE || id + 1 == options.document_count) {
+			server.AddDocuments(batch);
+			batch.clear();
+		}
+	}
+	texts.clear();
+
+	const Clock::duration total_window = options.duration + options.report_interval;
+	QueryTelemetry query_interval(options.report_interval), query_total(total_window);
+	QueryTelemetry write_interval(options.report_interval), write_total(total_window);
+	LoadState state{ server, dictionary, queries, options, query_interval, query_total, write_interval, write_total,
+		{ false }, { 0 }, { options.document_count }, { 0 } };
+
+	std::cout << "query threads: "sv << options.query_thread_count;
+	if (options.batch_size > 0) {
+		std::cout << ", ProcessQueries batches of "sv << options.batch_size;
+	}
+	std::cout << ", writer threads: "sv << options.writer_thread_count << ", documents: "sv << options.document_count << std::endl;
+	PrintHeader();
+
+	const Clock::time_point start = Clock::now();
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < options.query_thread_count; ++i) {
+		threads.emplace_back(RunQueries, std::ref(state), i, start);
+	}
+	for (size_t i = 0; i < options.writer_thread_count; ++i) {
+		threads.emplace_back(RunWrites, std::ref(state), i, start);
+	}
+	for (Clock::time_point report = start + options.report_interval; report <= start + options.duration; report += options.report_interval) {
+		std::this_thread::sleep_until(report);
+		const std::chrono::duration<double> elapsed = Clock::now() - start;
+		std::ostringstream mark;
+		mark << std::fixed << std::setprecision(1) << elapsed.count();
+		PrintLine(mark.str(), query_interval.GetStats(), write_interval.GetStats(), server.GetDocumentCount());
+	}
+	state.is_stopping = true;
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+
+	const QueryTelemetryStats query_stats = query_total.GetStats();
+	const QueryTelemetryStats write_stats = write_total.GetStats();
+	PrintLine("total"s, query_stats, write_stats, server.GetDocumentCount());
+	std::cout << query_stats.request_count << " requests, "sv << write_stats.request_count << " writes"sv << std::endl;
+	return 0;
+}
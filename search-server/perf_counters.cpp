@@ -0,0 +1,115 @@
+#include "perf_counters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstring>
+#endif
+
+namespace {
+
+#ifdef __linux__
+perf_event_attr MakeAttr(PerfEvent event) {
+	perf_event_attr attr;
+	std::memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	switch (event) {
+	case PerfEvent::CYCLES:
+		attr.config = PERF_COUNT_HW_CPU_CYCLES;
+		break;
+	case PerfEvent::INSTRUCTIONS:
+		attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+		break;
+	case PerfEvent::LLC_MISSES:
+		attr.type = PERF_TYPE_HW_CACHE;
+		attr.config = PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+		break;
+	case PerfEvent::BRANCH_MISSES:
+		attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+		break;
+	case PerfEvent::DTLB_MISSES:
+		attr.type = PERF_TYPE_HW_CACHE;
+		attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+		break;
+	}
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	return attr;
+}
+#endif
+
+}  // namespace
+
+PerfCounters::PerfCounters() {
+	fds_.fill(-1);
+#ifdef __linux__
+	for (size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+		perf_event_attr attr = MakeAttr(static_cast<PerfEvent>(i));
+		const int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd_, 0));
+		if (fd < 0) {
+			continue;
+		}
+		fds_[i] = fd;
+		if (group_fd_ < 0) {
+			group_fd_ = fd;
+		}
+		positions_[i] = counter_count_++;
+	}
+	if (group_fd_ >= 0) {
+		ioctl(group_fd_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+		ioctl(group_fd_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	}
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+	for (const int fd : fds_) {
+		if (fd >= 0) {
+			close(fd);
+		}
+	}
+#endif
+}
+
+bool PerfCounters::IsAvailable() const {
+	return group_fd_ >= 0;
+}
+
+PerfCounterValues PerfCounters::Read() const {
+	PerfCounterValues result;
+#ifdef __linux__
+	if (group_fd_ < 0) {
+		return result;
+	}
+	// number of counters, time enabled, time running, then the counters in group order
+	uint64_t buffer[3 + PERF_EVENT_COUNT];
+	const ssize_t size = read(group_fd_, buffer, sizeof(buffer));
+	if (size < static_cast<ssize_t>((3 + counter_count_) * sizeof(uint64_t)) || buffer[0] != counter_count_) {
+		return result;
+	}
+	const uint64_t time_enabled = buffer[1];
+	const uint64_t time_running = buffer[2];
+	// the group never got onto the hardware, there is nothing to scale
+	if (time_running == 0 && time_enabled > 0) {
+		return result;
+	}
+	for (size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+		if (!positions_[i]) {
+			continue;
+		}
+		uint64_t value = buffer[3 + *positions_[i]];
+		if (time_running > 0 && time_running < time_enabled) {
+			value = static_cast<uint64_t>(static_cast<double>(value) * time_enabled / time_running);
+		}
+		result.values[i] = value;
+	}
+#endif
+	return result;
+}
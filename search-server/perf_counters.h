@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+enum class PerfEvent {
+	CYCLES,
+	INSTRUCTIONS,
+	// last level cache read misses
+	LLC_MISSES,
+	BRANCH_MISSES,
+	// data TLB read misses
+	DTLB_MISSES,
+};
+
+const size_t PERF_EVENT_COUNT = 5;
+
+struct PerfCounterValues {
+	// empty for the events the machine or the permissions do not allow to count
+	std::array<std::optional<uint64_t>, PERF_EVENT_COUNT> values;
+
+	const std::optional<uint64_t>& operator[](PerfEvent event) const {
+		return values[static_cast<size_t>(event)];
+	}
+};
+
+// Hardware counters of the calling thread from construction on, counted by the kernel
+// through perf_event_open in user space only. Threads of a parallel algorithm are not
+// counted, only the share of the thread that waits for them. Counters that cannot be
+// opened (other systems, virtual machines, perf_event_paranoid) are left out; when
+// none opens, IsAvailable is false and Read is empty.
+class PerfCounters {
+public:
+	PerfCounters();
+
+	PerfCounters(const PerfCounters&) = delete;
+
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+	~PerfCounters();
+
+	bool IsAvailable() const;
+
+	// scaled up when the kernel had to multiplex the counters with other users
+	PerfCounterValues Read() const;
+
+private:
+	// the first opened counter leads the group, so all of them run at the same time
+	int group_fd_ = -1;
+	// position of each event in a read of the group, empty when not counted
+	std::array<std::optional<size_t>, PERF_EVENT_COUNT> positions_;
+	size_t counter_count_ = 0;
+	std::array<int, PERF_EVENT_COUNT> fds_;
+};
@@ -0,0 +1,61 @@
+#include "perfect_hash.h"
+
+#include <algorithm>
+#include <utility>
+
+PerfectHash::PerfectHash(const std::vector<std::string_view>& words)
+	: displacements_(GetBucketCount(words.size())), size_(words.size()) {
+	std::vector<uint32_t> slot_words(words.size());
+	std::vector<uint32_t> bucket_starts(displacements_.size() + 1);
+	std::vector<uint32_t> bucket_words(words.size());
+	std::vector<bool> is_taken(words.size());
+	while (!Place(words, size_, seed_, displacements_, displacements_.size(), slot_words, bucket_starts, bucket_words, is_taken)) {
+		++seed_;
+	}
+}
+
+PerfectHash::PerfectHash(uint64_t seed, std::vector<uint32_t> displacements, size_t size)
+	: seed_(seed), displacements_(std::move(displacements)), size_(size) {
+}
+
+size_t PerfectHash::size() const {
+	return size_;
+}
+
+size_t PerfectHash::GetMemoryUsage() const {
+	return displacements_.capacity() * sizeof(uint32_t);
+}
+
+FrozenWordSet::FrozenWordSet(std::vector<std::string_view> words) {
+	std::sort(words.begin(), words.end());
+	words.erase(std::unique(words.begin(), words.end()), words.end());
+	hash_ = PerfectHash(words);
+	std::vector<std::string_view> slot_words(words.size());
+	for (const std::string_view word : words) {
+		slot_words[hash_.GetSlot(word)] = word;
+	}
+	StoreWords(slot_words);
+}
+
+std::vector<std::string_view> FrozenWordSet::GetWords() const {
+	std::vector<std::string_view> words;
+	words.reserve(size());
+	for (size_t slot = 0; slot < size(); ++slot) {
+		words.emplace_back(chars_.data() + offsets_[slot], offsets_[slot + 1] - offsets_[slot]);
+	}
+	std::sort(words.begin(), words.end());
+	return words;
+}
+
+size_t FrozenWordSet::size() const {
+	return hash_.size();
+}
+
+void FrozenWordSet::StoreWords(const std::vector<std::string_view>& slot_words) {
+	offsets_.reserve(slot_words.size() + 1);
+	offsets_.push_back(0);
+	for (const std::string_view word : slot_words) {
+		chars_.append(word);
+		offsets_.push_back(static_cast<uint32_t>(chars_.size()));
+	}
+}
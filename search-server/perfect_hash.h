@@ -0,0 +1,274 @@
+#pragma once
+
+#include "string_processing.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Minimal perfect hash of a fixed set of distinct words, built by hash and displace:
+// a word hashes to a bucket, and the displacement of the bucket sends every word of
+// it to a slot of its own in [0, size). Any other word lands on some slot as well, so
+// a lookup is one hash of the word and one compare with the word of its slot.
+// All of it is constexpr, so word sets known at build time are hashed by the compiler.
+class PerfectHash {
+public:
+	// a displacement with this bit holds the slot of a single-word bucket itself
+	static constexpr uint32_t DIRECT_SLOT = uint32_t{ 1 } << 31;
+	static constexpr size_t WORDS_PER_BUCKET = 4;
+	static constexpr uint32_t MAX_DISPLACEMENT = 1 << 16;
+
+	static constexpr size_t GetBucketCount(size_t size) {
+		return size / WORDS_PER_BUCKET + 1;
+	}
+
+	// FNV-1a, then the 64-bit finalizer of MurmurHash3
+	static constexpr uint64_t HashWord(std::string_view word, uint64_t seed) {
+		uint64_t hash = 14695981039346656037ull ^ seed;
+		for (const char c : word) {
+			hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+		}
+		return Mix(hash);
+	}
+
+	template <typename Displacements>
+	static constexpr size_t FindSlot(uint64_t hash, const Displacements& displacements, size_t bucket_count, size_t size) {
+		const uint32_t displacement = displacements[hash % bucket_count];
+		if ((displacement & DIRECT_SLOT) != 0) {
+			return displacement & ~DIRECT_SLOT;
+		}
+		return Mix(hash + displacement * 0x9e3779b97f4a7c15ull) % size;
+	}
+
+	// Fills displacements (bucket_count of them) and slot_words, the index of the word
+	// of every slot. Buckets are placed from the largest down, each with the first
+	// displacement that sends its words to free slots; single words take the free slots
+	// left. False when some bucket found no displacement: another seed is needed.
+	template <typename Words, typename Displacements, typename Indexes, typename Starts, typename Flags>
+	static constexpr bool Place(const Words& words, size_t size, uint64_t seed, Displacements& displacements,
+		size_t bucket_count, Indexes& slot_words, Starts& bucket_starts, Indexes& bucket_words, Flags& is_taken);
+
+	PerfectHash() = default;
+
+	// words must be distinct
+	explicit PerfectHash(const std::vector<std::string_view>& words);
+
+	// tables computed before, at compile time for a StaticWordSet
+	PerfectHash(uint64_t seed, std::vector<uint32_t> displacements, size_t size);
+
+	// slot of a word of the set; any other word also gets some slot
+	size_t GetSlot(std::string_view word) const {
+		return FindSlot(HashWord(word, seed_), displacements_, displacements_.size(), size_);
+	}
+
+	size_t size() const;
+
+	size_t GetMemoryUsage() const;
+
+private:
+	uint64_t seed_ = 0;
+	std::vector<uint32_t> displacements_;
+	size_t size_ = 0;
+
+	static constexpr uint64_t Mix(uint64_t hash) {
+		hash = (hash ^ (hash >> 33)) * 0xff51afd7ed558ccdull;
+		hash = (hash ^ (hash >> 33)) * 0xc4ceb9fe1a85ec53ull;
+		return hash ^ (hash >> 33);
+	}
+};
+
+// Set of words known at build time, hashed by the compiler:
+//     constexpr auto STOP_WORDS = MakeStaticWordSet("and", "in", "on");
+// The words must be distinct, non-empty and valid, or the set does not compile.
+template <size_t N>
+class StaticWordSet {
+public:
+	static constexpr size_t BUCKET_COUNT = PerfectHash::GetBucketCount(N);
+
+	constexpr explicit StaticWordSet(const std::array<std::string_view, N>& words);
+
+	constexpr bool Contains(std::string_view word) const {
+		if (N == 0) {
+			return false;
+		}
+		const uint64_t hash = PerfectHash::HashWord(word, seed_);
+		return slot_words_[PerfectHash::FindSlot(hash, displacements_, BUCKET_COUNT, N)] == word;
+	}
+
+	constexpr uint64_t GetSeed() const {
+		return seed_;
+	}
+
+	constexpr const std::array<uint32_t, BUCKET_COUNT>& GetDisplacements() const {
+		return displacements_;
+	}
+
+	constexpr const std::array<std::string_view, N>& GetSlotWords() const {
+		return slot_words_;
+	}
+
+private:
+	uint64_t seed_ = 0;
+	std::array<uint32_t, BUCKET_COUNT> displacements_{};
+	std::array<std::string_view, N> slot_words_{};
+};
+
+template <typename... Words>
+constexpr StaticWordSet<sizeof...(Words)> MakeStaticWordSet(const Words&... words) {
+	return StaticWordSet<sizeof...(Words)>({ std::string_view(words)... });
+}
+
+// Immutable set of words behind a PerfectHash. The words are kept in slot order in
+// one buffer, so Contains is one hash and one compare, and copies need no rebuild.
+class FrozenWordSet {
+public:
+	FrozenWordSet() = default;
+
+	// duplicates are dropped
+	explicit FrozenWordSet(std::vector<std::string_view> words);
+
+	template <size_t N>
+	explicit FrozenWordSet(const StaticWordSet<N>& words);
+
+	bool Contains(std::string_view word) const {
+		if (offsets_.size() <= 1) {
+			return false;
+		}
+		const size_t slot = hash_.GetSlot(word);
+		return std::string_view(chars_.data() + offsets_[slot], offsets_[slot + 1] - offsets_[slot]) == word;
+	}
+
+	// in sorted order
+	std::vector<std::string_view> GetWords() const;
+
+	size_t size() const;
+
+private:
+	PerfectHash hash_;
+	std::string chars_;
+	// the word of slot i is chars_[offsets_[i], offsets_[i + 1])
+	std::vector<uint32_t> offsets_;
+
+	// words in slot order
+	void StoreWords(const std::vector<std::string_view>& slot_words);
+};
+
+template <typename Words, typename Displacements, typename Indexes, typename Starts, typename Flags>
+constexpr bool PerfectHash::Place(const Words& words, size_t size, uint64_t seed, Displacements& displacements,
+	size_t bucket_count, Indexes& slot_words, Starts& bucket_starts, Indexes& bucket_words, Flags& is_taken) {
+	// words grouped by bucket with a counting sort, slot_words holds their buckets meanwhile
+	for (size_t bucket = 0; bucket <= bucket_count; ++bucket) {
+		bucket_starts[bucket] = 0;
+	}
+	for (size_t word = 0; word < size; ++word) {
+		slot_words[word] = static_cast<uint32_t>(HashWord(words[word], seed) % bucket_count);
+		++bucket_starts[slot_words[word] + 1];
+	}
+	size_t max_bucket_size = 0;
+	for (size_t bucket = 0; bucket < bucket_count; ++bucket) {
+		max_bucket_size = max_bucket_size > bucket_starts[bucket + 1] ? max_bucket_size : bucket_starts[bucket + 1];
+		bucket_starts[bucket + 1] += bucket_starts[bucket];
+	}
+	for (size_t word = 0; word < size; ++word) {
+		// bucket_starts[bucket] moves to the end of the bucket, shifted back below
+		bucket_words[bucket_starts[slot_words[word]]++] = static_cast<uint32_t>(word);
+	}
+	for (size_t bucket = bucket_count; bucket > 0; --bucket) {
+		bucket_starts[bucket] = bucket_starts[bucket - 1];
+	}
+	bucket_starts[0] = 0;
+	for (size_t slot = 0; slot < size; ++slot) {
+		is_taken[slot] = false;
+	}
+
+	for (size_t bucket_size = max_bucket_size; bucket_size > 1; --bucket_size) {
+		for (size_t bucket = 0; bucket < bucket_count; ++bucket) {
+			const size_t first = bucket_starts[bucket];
+			if (bucket_starts[bucket + 1] - first != bucket_size) {
+				continue;
+			}
+			bool is_placed = false;
+			for (uint32_t displacement = 0; !is_placed && displacement < MAX_DISPLACEMENT; ++displacement) {
+				displacements[bucket] = displacement;
+				size_t placed_count = 0;
+				while (placed_count < bucket_size) {
+					const uint32_t word = bucket_words[first + placed_count];
+					const size_t slot = FindSlot(HashWord(words[word], seed), displacements, bucket_count, size);
+					if (is_taken[slot]) {
+						break;
+					}
+					is_taken[slot] = true;
+					slot_words[slot] = word;
+					++placed_count;
+				}
+				is_placed = placed_count == bucket_size;
+				// a failed displacement frees the slots it took
+				for (size_t i = 0; !is_placed && i < placed_count; ++i) {
+					is_taken[FindSlot(HashWord(words[bucket_words[first + i]], seed), displacements, bucket_count, size)] = false;
+				}
+			}
+			if (!is_placed) {
+				return false;
+			}
+		}
+	}
+
+	size_t free_slot = 0;
+	for (size_t bucket = 0; bucket < bucket_count; ++bucket) {
+		const size_t first = bucket_starts[bucket];
+		if (bucket_starts[bucket + 1] - first > 1) {
+			continue;
+		}
+		if (bucket_starts[bucket + 1] == first) {
+			displacements[bucket] = 0;
+			continue;
+		}
+		while (is_taken[free_slot]) {
+			++free_slot;
+		}
+		is_taken[free_slot] = true;
+		slot_words[free_slot] = bucket_words[first];
+		displacements[bucket] = DIRECT_SLOT | static_cast<uint32_t>(free_slot);
+	}
+	return true;
+}
+
+template <size_t N>
+constexpr StaticWordSet<N>::StaticWordSet(const std::array<std::string_view, N>& words) {
+	for (size_t i = 0; i < N; ++i) {
+		if (words[i].empty()) {
+			throw std::invalid_argument("Stop word is empty");
+		}
+		for (const char c : words[i]) {
+			if (c >= '\0' && c < ' ') {
+				throw std::invalid_argument("Stop word is invalid");
+			}
+		}
+		for (size_t j = 0; j < i; ++j) {
+			if (words[i] == words[j]) {
+				throw std::invalid_argument("Stop words repeat");
+			}
+		}
+	}
+
+	std::array<uint32_t, N> slot_words{};
+	std::array<uint32_t, BUCKET_COUNT + 1> bucket_starts{};
+	std::array<uint32_t, N> bucket_words{};
+	std::array<bool, N> is_taken{};
+	while (!PerfectHash::Place(words, N, seed_, displacements_, BUCKET_COUNT, slot_words, bucket_starts, bucket_words, is_taken)) {
+		++seed_;
+	}
+	for (size_t slot = 0; slot < N; ++slot) {
+		slot_words_[slot] = words[slot_words[slot]];
+	}
+}
+
+template <size_t N>
+FrozenWordSet::FrozenWordSet(const StaticWordSet<N>& words)
+	: hash_(words.GetSeed(), std::vector<uint32_t>(words.GetDisplacements().begin(), words.GetDisplacements().end()), N) {
+	StoreWords(std::vector<std::string_view>(words.GetSlotWords().begin(), words.GetSlotWords().end()));
+}
@@ -0,0 +1,134 @@
+#include "posting_list.h"
+
+#include <algorithm>
+
+namespace {
+	bool OrdinalLess(const PostingList::Posting& posting, DocumentOrdinal ordinal) {
+		return posting.ordinal < ordinal;
+	}
+}
+
+double PostingList::AddTermFreq(DocumentOrdinal ordinal, double term_freq) {
+	size_t index = postings_.size();
+	// ordinals grow with every added document, so appending is the common case
+	if (postings_.empty() || postings_.back().ordinal < ordinal) {
+		postings_.push_back({ ordinal, term_freq });
+	}
+	else {
+		auto it = std::lower_bound(postings_.begin(), postings_.end(), ordinal, OrdinalLess);
+		index = it - postings_.begin();
+		if (it == postings_.end() || it->ordinal != ordinal) {
+			postings_.insert(it, { ordinal, term_freq });
+			UpdateBlocks(index);
+			return term_freq;
+		}
+		it->term_freq += term_freq;
+	}
+
+	// nothing has shifted and the frequency only grew, so the bounds can only grow too
+	const double result = postings_[index].term_freq;
+	const size_t block = index / BLOCK_SIZE;
+	if (block == block_max_term_freqs_.size()) {
+		block_max_term_freqs_.push_back(result);
+	}
+	else {
+		block_max_term_freqs_[block] = std::max(block_max_term_freqs_[block], result);
+	}
+	max_term_freq_ = std::max(max_term_freq_, result);
+	return result;
+}
+
+void PostingList::SetTermFreq(DocumentOrdinal ordinal, double term_freq) {
+	const auto it = std::lower_bound(postings_.begin(), postings_.end(), ordinal, OrdinalLess);
+	if (it == postings_.end() || it->ordinal != ordinal) {
+		AddTermFreq(ordinal, term_freq);
+		return;
+	}
+	it->term_freq = term_freq;
+	// nothing has shifted, only the bound of this block may have changed
+	const size_t block = (it - postings_.begin()) / BLOCK_SIZE;
+	block_max_term_freqs_[block] = ComputeBlockMaxTermFreq(block);
+	max_term_freq_ = *std::max_element(block_max_term_freqs_.begin(), block_max_term_freqs_.end());
+}
+
+const PostingList::Posting* PostingList::Find(DocumentOrdinal ordinal) const {
+	const auto it = std::lower_bound(postings_.begin(), postings_.end(), ordinal, OrdinalLess);
+	if (it == postings_.end() || it->ordinal != ordinal) {
+		return nullptr;
+	}
+	return &*it;
+}
+
+bool PostingList::Contains(DocumentOrdinal ordinal) const {
+	return Find(ordinal) != nullptr;
+}
+
+bool PostingList::Erase(DocumentOrdinal ordinal) {
+	const auto it = std::lower_bound(postings_.begin(), postings_.end(), ordinal, OrdinalLess);
+	if (it == postings_.end() || it->ordinal != ordinal) {
+		return false;
+	}
+	const size_t index = it - postings_.begin();
+	postings_.erase(it);
+	UpdateBlocks(index);
+	return true;
+}
+
+void PostingList::RenumberOrdinals(const std::vector<DocumentOrdinal>& new_ordinals) {
+	for (Posting& posting : postings_) {
+		posting.ordinal = new_ordinals[posting.ordinal];
+	}
+}
+
+size_t PostingList::LowerBound(DocumentOrdinal ordinal, size_t position) const {
+	// gallop from the current position first: skips are usually short
+	size_t step = 1;
+	size_t last = position;
+	while (last < postings_.size() && postings_[last].ordinal < ordinal) {
+		position = last + 1;
+		last += step;
+		step *= 2;
+	}
+	last = std::min(last, postings_.size());
+	return std::lower_bound(postings_.begin() + position, postings_.begin() + last, ordinal, OrdinalLess) - postings_.begin();
+}
+
+double PostingList::GetMaxTermFreq() const {
+	return max_term_freq_;
+}
+
+bool PostingList::empty() const {
+	return postings_.empty();
+}
+
+size_t PostingList::GetMemoryUsage() const {
+	return sizeof(*this) + postings_.capacity() * sizeof(Posting) + block_max_term_freqs_.capacity() * sizeof(double);
+}
+
+PostingList::const_iterator PostingList::begin() const {
+	return postings_.begin();
+}
+
+PostingList::const_iterator PostingList::end() const {
+	return postings_.end();
+}
+
+void PostingList::UpdateBlocks(size_t first_index) {
+	// postings after first_index may have shifted between blocks
+	const size_t first_block = first_index / BLOCK_SIZE;
+	block_max_term_freqs_.resize((postings_.size() + BLOCK_SIZE - 1) / BLOCK_SIZE);
+	for (size_t block = first_block; block < block_max_term_freqs_.size(); ++block) {
+		block_max_term_freqs_[block] = ComputeBlockMaxTermFreq(block);
+	}
+	max_term_freq_ = block_max_term_freqs_.empty() ? 0.0
+		: *std::max_element(block_max_term_freqs_.begin(), block_max_term_freqs_.end());
+}
+
+double PostingList::ComputeBlockMaxTermFreq(size_t block) const {
+	const auto first = postings_.begin() + block * BLOCK_SIZE;
+	const auto last = postings_.begin() + std::min(postings_.size(), (block + 1) * BLOCK_SIZE);
+	return std::max_element(first, last,
+		[](const Posting& lhs, const Posting& rhs) {
+			return lhs.term_freq < rhs.term_freq;
+		})->term_freq;
+}
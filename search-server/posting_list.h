@@ -0,0 +1,170 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Internal dense document number assigned by SearchServer in insertion order
+using DocumentOrdinal = uint32_t;
+
+class PostingCursor;
+
+// Contiguous posting list of a single term: (ordinal, term_freq) pairs
+// kept sorted by ordinal, so traversal is a linear scan over one array
+// and point lookups are a binary search.
+// Postings are grouped in blocks of BLOCK_SIZE, and the largest term_freq of
+// every block and of the whole list is kept up to date for dynamic pruning.
+class PostingList {
+public:
+	static constexpr size_t BLOCK_SIZE = 64;
+
+	struct Posting {
+		DocumentOrdinal ordinal;
+		double term_freq;
+	};
+
+	using const_iterator = std::vector<Posting>::const_iterator;
+	using Cursor = PostingCursor;
+
+	// adds a non-negative term_freq to the posting of ordinal, creating it when absent
+	double AddTermFreq(DocumentOrdinal ordinal, double term_freq);
+
+	// replaces the term_freq of the posting of ordinal, creating it when absent
+	void SetTermFreq(DocumentOrdinal ordinal, double term_freq);
+
+	const Posting* Find(DocumentOrdinal ordinal) const;
+
+	bool Contains(DocumentOrdinal ordinal) const;
+
+	bool Erase(DocumentOrdinal ordinal);
+
+	// new_ordinals must preserve the relative order of the ordinals present in the list
+	void RenumberOrdinals(const std::vector<DocumentOrdinal>& new_ordinals);
+
+	// index of the first posting at or after position whose ordinal is not less than ordinal
+	size_t LowerBound(DocumentOrdinal ordinal, size_t position = 0) const;
+
+	const Posting& GetPosting(size_t index) const {
+		return postings_[index];
+	}
+
+	double GetMaxTermFreq() const;
+
+	double GetBlockMaxTermFreq(size_t block) const {
+		return block_max_term_freqs_[block];
+	}
+
+	DocumentOrdinal GetBlockLastOrdinal(size_t block) const {
+		const size_t block_end = (block + 1) * BLOCK_SIZE;
+		return postings_[(block_end < postings_.size() ? block_end : postings_.size()) - 1].ordinal;
+	}
+
+	size_t GetBlockCount() const {
+		return block_max_term_freqs_.size();
+	}
+
+	size_t size() const {
+		return postings_.size();
+	}
+
+	bool empty() const;
+
+	size_t GetMemoryUsage() const;
+
+	const_iterator begin() const;
+
+	const_iterator end() const;
+
+private:
+	std::vector<Posting> postings_;
+	std::vector<double> block_max_term_freqs_;
+	double max_term_freq_ = 0.0;
+
+	void UpdateBlocks(size_t first_index);
+
+	double ComputeBlockMaxTermFreq(size_t block) const;
+};
+
+// Forward-only position in a posting list for document-at-a-time traversal.
+// Defined inline: it sits in the innermost loop of pruned retrieval.
+class PostingCursor {
+public:
+	// ordinal reported once the cursor has passed the last posting
+	static constexpr DocumentOrdinal END = std::numeric_limits<DocumentOrdinal>::max();
+
+	explicit PostingCursor(const PostingList& postings)
+		: postings_(&postings) {
+		UpdateOrdinal();
+	}
+
+	bool IsEnd() const {
+		return ordinal_ == END;
+	}
+
+	DocumentOrdinal GetOrdinal() const {
+		return ordinal_;
+	}
+
+	double GetTermFreq() const {
+		return postings_->GetPosting(position_).term_freq;
+	}
+
+	void Next() {
+		++position_;
+		UpdateOrdinal();
+	}
+
+	// moves to the first posting whose ordinal is not less than ordinal
+	void SkipTo(DocumentOrdinal ordinal) {
+		if (ordinal_ < ordinal) {
+			position_ = postings_->LowerBound(ordinal, position_);
+			UpdateOrdinal();
+		}
+	}
+
+	double GetMaxTermFreq() const {
+		return postings_->GetMaxTermFreq();
+	}
+
+	// bounds of the block holding the current posting
+	double GetBlockMaxTermFreq() const {
+		return postings_->GetBlockMaxTermFreq(position_ / PostingList::BLOCK_SIZE);
+	}
+
+	DocumentOrdinal GetBlockLastOrdinal() const {
+		return postings_->GetBlockLastOrdinal(position_ / PostingList::BLOCK_SIZE);
+	}
+
+	// bound of the block that would hold ordinal, without moving the cursor itself:
+	// a separate block position follows the requests, which must not decrease
+	double GetBlockMaxTermFreqAt(DocumentOrdinal ordinal) {
+		if (block_ < position_ / PostingList::BLOCK_SIZE) {
+			block_ = position_ / PostingList::BLOCK_SIZE;
+		}
+		while (block_ < postings_->GetBlockCount() && postings_->GetBlockLastOrdinal(block_) < ordinal) {
+			++block_;
+		}
+		return block_ < postings_->GetBlockCount() ? postings_->GetBlockMaxTermFreq(block_) : 0.0;
+	}
+
+	// bound of the blocks that would hold the ordinals [first, last], the same way
+	double GetMaxTermFreqIn(DocumentOrdinal first, DocumentOrdinal last) {
+		double max_term_freq = GetBlockMaxTermFreqAt(first);
+		for (size_t block = block_; block + 1 < postings_->GetBlockCount() && postings_->GetBlockLastOrdinal(block) < last; ++block) {
+			max_term_freq = std::max(max_term_freq, postings_->GetBlockMaxTermFreq(block + 1));
+		}
+		return max_term_freq;
+	}
+
+private:
+	const PostingList* postings_;
+	size_t position_ = 0;
+	size_t block_ = 0;
+	DocumentOrdinal ordinal_ = END;
+
+	void UpdateOrdinal() {
+		ordinal_ = position_ < postings_->size() ? postings_->GetPosting(position_).ordinal : END;
+	}
+};
@@ -3,31 +3,15 @@
 std::vector<std::vector<Document>> ProcessQueries(
 		const SearchServer& search_server,
 		const std::vector<std::string>& queries) {
-	std::vector<std::vector<Document>> result(queries.size());
-	std::transform(
-			std::execution::par,
-			queries.cbegin(), queries.cend(),
-			result.begin(),
-			[&search_server](const std::string& query) {
-				return search_server.FindTopDocuments(query);
-			}
-	);
-	return result;
+	return search_server.FindTopDocumentsBatch(std::vector<std::string_view>(queries.begin(), queries.end()));
 }
 
 std::vector<Document> ProcessQueriesJoined(
 	const SearchServer& search_server,
 	const std::vector<std::string>& queries) {
-	std::vector<std::vector<Document>> documents = ProcessQueries(search_server, queries);
-
 	std::vector<Document> result;
-	result.reserve(documents.size());
-	for (const std::vector<Document>& document: documents) {
-		std::transform(document.cbegin(), document.cend(),
-						std::back_inserter(result),
-						[](const Document& doc) {
-						return doc;}
-					);
-	}
+	ProcessQueriesJoined(search_server, queries, [&result](const Document& document) {
+		result.push_back(document);
+	});
 	return result;
 }
@@ -5,7 +5,13 @@
 #include <vector>
 #include <algorithm>
 #include <execution>
+#include <future>
+#include <string_view>
 
+// number of queries ProcessQueriesJoined searches at once when it streams
+const size_t PROCESS_QUERIES_WINDOW = 4096;
+
+// results of FindTopDocuments for every query, the queries of the batch share their scans
 std::vector<std::vector<Document>> ProcessQueries(
 		const SearchServer& search_server,
 		const std::vector<std::string>& queries);
@@ -14,3 +20,32 @@ std::vector<Document> ProcessQueriesJoined(
 		const SearchServer& search_server,
 		const std::vector<std::string>& queries);
 
+// Hands the documents of ProcessQueriesJoined to consumer one by one, in the same order.
+// Queries are searched a window at a time, the next window while consumer takes the
+// current one, so no more than two windows of results are held at once.
+template <typename Consumer>
+void ProcessQueriesJoined(
+		const SearchServer& search_server,
+		const std::vector<std::string>& queries,
+		Consumer consumer) {
+	const auto find_window = [&search_server, &queries](size_t first) {
+		const size_t last = std::min(first + PROCESS_QUERIES_WINDOW, queries.size());
+		return search_server.FindTopDocumentsBatch(
+				std::vector<std::string_view>(queries.begin() + first, queries.begin() + last));
+	};
+	if (queries.empty()) {
+		return;
+	}
+	auto next_window = std::async(std::launch::async, find_window, 0);
+	for (size_t first = 0; first < queries.size(); first += PROCESS_QUERIES_WINDOW) {
+		const std::vector<std::vector<Document>> window = next_window.get();
+		if (first + PROCESS_QUERIES_WINDOW < queries.size()) {
+			next_window = std::async(std::launch::async, find_window, first + PROCESS_QUERIES_WINDOW);
+		}
+		for (const std::vector<Document>& documents : window) {
+			for (const Document& document : documents) {
+				consumer(document);
+			}
+		}
+	}
+}
@@ -0,0 +1,96 @@
+#include "query_result_cache.h"
+
+QueryResultCache::QueryResultCache(const SearchServer& search_server, size_t max_bytes)
+	: search_server_(search_server), max_bytes_(max_bytes), generation_(search_server.GetGeneration()) {
+}
+
+std::vector<Document> QueryResultCache::FindTopDocuments(std::string_view raw_query, DocumentStatus status) {
+	std::string key = MakeKey(raw_query, 's', std::to_string(static_cast<int>(status)));
+	uint64_t generation = 0;
+	if (auto documents = Find(key, generation)) {
+		return std::move(*documents);
+	}
+	auto documents = search_server_.FindTopDocuments(raw_query, status);
+	Insert(std::move(key), documents, generation);
+	return documents;
+}
+
+QueryCacheStats QueryResultCache::GetStats() const {
+	std::lock_guard guard(mutex_);
+	return stats_;
+}
+
+void QueryResultCache::Clear() {
+	std::lock_guard guard(mutex_);
+	DropEntries();
+}
+
+std::string QueryResultCache::MakeKey(std::string_view raw_query, char kind, std::string_view tag) const {
+	// kind keeps status keys apart from predicate tags, a newline ends each part
+	std::string key(1, kind);
+	key += tag;
+	key += '\n';
+	key += std::to_string(search_server_.GetMaxResultDocumentCount());
+	key += '\n';
+	key += search_server_.GetCanonicalQuery(raw_query);
+	return key;
+}
+
+std::optional<std::vector<Document>> QueryResultCache::Find(const std::string& key, uint64_t& generation) {
+	std::lock_guard guard(mutex_);
+	if (generation_ != search_server_.GetGeneration()) {
+		if (!entries_.empty()) {
+			DropEntries();
+			++stats_.invalidations;
+		}
+		generation_ = search_server_.GetGeneration();
+	}
+	generation = generation_;
+
+	const auto it = entry_index_.find(key);
+	if (it == entry_index_.end()) {
+		++stats_.misses;
+		return std::nullopt;
+	}
+	++stats_.hits;
+	entries_.splice(entries_.begin(), entries_, it->second);
+	return it->second->documents;
+}
+
+void QueryResultCache::Insert(std::string key, const std::vector<Document>& documents, uint64_t generation) {
+	std::lock_guard guard(mutex_);
+	// another thread may have added the same key meanwhile, or the server moved on
+	if (generation != generation_ || entry_index_.count(key) > 0) {
+		return;
+	}
+	Entry entry{ std::move(key), documents };
+	const size_t entry_bytes = GetEntryBytes(entry);
+	if (entry_bytes > max_bytes_) {
+		return;
+	}
+	while (stats_.bytes + entry_bytes > max_bytes_) {
+		const Entry& last = entries_.back();
+		stats_.bytes -= GetEntryBytes(last);
+		entry_index_.erase(last.key);
+		entries_.pop_back();
+		++stats_.evictions;
+	}
+	entries_.push_front(std::move(entry));
+	entry_index_.emplace(entries_.front().key, entries_.begin());
+	stats_.bytes += entry_bytes;
+	stats_.entry_count = entries_.size();
+}
+
+void QueryResultCache::DropEntries() {
+	entry_index_.clear();
+	entries_.clear();
+	stats_.entry_count = 0;
+	stats_.bytes = 0;
+}
+
+size_t QueryResultCache::GetEntryBytes(const Entry& entry) {
+	// list node, index node and the heap blocks of the entry
+	return sizeof(Entry) + 2 * sizeof(void*)
+		+ sizeof(std::pair<const std::string_view, std::list<Entry>::iterator>) + 2 * sizeof(void*)
+		+ entry.key.capacity() + entry.documents.capacity() * sizeof(Document);
+}
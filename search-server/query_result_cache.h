@@ -0,0 +1,86 @@
+#pragma once
+
+#include "search_server.h"
+#include "document.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+struct QueryCacheStats {
+	size_t hits = 0;
+	size_t misses = 0;
+	size_t evictions = 0;
+	// times the entries were dropped because the server changed
+	size_t invalidations = 0;
+	size_t entry_count = 0;
+	size_t bytes = 0;
+};
+
+// Memory-bounded LRU cache of search results in front of a SearchServer. Entries are
+// keyed by the canonical form of the query, so queries that differ only in word order,
+// repeated or stop words share one. All entries are dropped once the generation of the
+// server changes. Lookups from several threads are safe while the server is not changed.
+class QueryResultCache {
+public:
+	QueryResultCache(const SearchServer& search_server, size_t max_bytes);
+
+	std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL);
+
+	// predicate_tag names the predicate: calls with equal tags must pass equivalent
+	// predicates. Tags must not hold a newline.
+	template <typename DocumentPredicate>
+	std::vector<Document> FindTopDocuments(std::string_view raw_query, std::string_view predicate_tag,
+		DocumentPredicate document_predicate);
+
+	QueryCacheStats GetStats() const;
+
+	void Clear();
+
+private:
+	struct Entry {
+		std::string key;
+		std::vector<Document> documents;
+	};
+
+	const SearchServer& search_server_;
+	const size_t max_bytes_;
+	mutable std::mutex mutex_;
+	// most recently used first
+	std::list<Entry> entries_;
+	// keys refer to the keys of entries_
+	std::unordered_map<std::string_view, std::list<Entry>::iterator> entry_index_;
+	uint64_t generation_ = 0;
+	QueryCacheStats stats_;
+
+	std::string MakeKey(std::string_view raw_query, char kind, std::string_view tag) const;
+
+	// the result also tells the generation a miss has to be computed at
+	std::optional<std::vector<Document>> Find(const std::string& key, uint64_t& generation);
+
+	void Insert(std::string key, const std::vector<Document>& documents, uint64_t generation);
+
+	void DropEntries();
+
+	static size_t GetEntryBytes(const Entry& entry);
+};
+
+template <typename DocumentPredicate>
+std::vector<Document> QueryResultCache::FindTopDocuments(std::string_view raw_query, std::string_view predicate_tag,
+	DocumentPredicate document_predicate) {
+	std::string key = MakeKey(raw_query, 'p', predicate_tag);
+	uint64_t generation = 0;
+	if (auto documents = Find(key, generation)) {
+		return std::move(*documents);
+	}
+	// computed outside the lock, so misses of different threads run in parallel
+	auto documents = search_server_.FindTopDocuments(raw_query, document_predicate);
+	Insert(std::move(key), documents, generation);
+	return documents;
+}
@@ -0,0 +1,127 @@
+#include "query_telemetry.h"
+
+#include <algorithm>
+#include <cmath>
+
+QueryTelemetry::QueryTelemetry(std::chrono::steady_clock::duration window)
+	: start_(std::chrono::steady_clock::now())
+	, slice_width_(std::max<std::chrono::steady_clock::duration>(window / SLICE_COUNT, std::chrono::steady_clock::duration(1)))
+	, slices_(std::make_unique<Slice[]>(SLICE_COUNT)) {
+}
+
+void QueryTelemetry::Record(std::chrono::steady_clock::duration latency, size_t result_count) {
+	const uint32_t slice_number = GetCurrentSlice();
+	Slice& slice = slices_[slice_number % SLICE_COUNT];
+	slice.request_count.Add(slice_number);
+	if (result_count == 0) {
+		slice.no_result_count.Add(slice_number);
+	}
+	const auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count();
+	slice.latency_bins[GetLatencyBin(std::max<int64_t>(nanoseconds, 0))].Add(slice_number);
+}
+
+QueryTelemetryStats QueryTelemetry::GetStats() const {
+	const uint32_t current_slice = GetCurrentSlice();
+	const uint32_t first_slice = GetFirstSlice(current_slice);
+
+	QueryTelemetryStats stats;
+	uint64_t latency_counts[LATENCY_BIN_COUNT] = {};
+	for (size_t i = 0; i < SLICE_COUNT; ++i) {
+		const Slice& slice = slices_[i];
+		stats.request_count += slice.request_count.Get(first_slice);
+		stats.no_result_count += slice.no_result_count.Get(first_slice);
+		for (size_t bin = 0; bin < LATENCY_BIN_COUNT; ++bin) {
+			latency_counts[bin] += slice.latency_bins[bin].Get(first_slice);
+		}
+	}
+
+	const std::chrono::duration<double> covered = std::chrono::steady_clock::now() - start_ - first_slice * slice_width_;
+	if (covered.count() > 0) {
+		stats.queries_per_second = stats.request_count / covered.count();
+	}
+	if (stats.request_count > 0) {
+		stats.no_result_rate = stats.no_result_count * 1.0 / stats.request_count;
+	}
+
+	// the counts of the bins may not add up to request_count while requests are recorded
+	uint64_t latency_count = 0;
+	for (const uint64_t count : latency_counts) {
+		latency_count += count;
+	}
+	const auto find_percentile = [&latency_counts, latency_count](double share) {
+		const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(share * latency_count)));
+		uint64_t seen_count = 0;
+		for (size_t bin = 0; bin < LATENCY_BIN_COUNT; ++bin) {
+			seen_count += latency_counts[bin];
+			if (seen_count >= rank) {
+				return std::chrono::nanoseconds(GetLatencyBinBound(bin));
+			}
+		}
+		return std::chrono::nanoseconds(0);
+	};
+	if (latency_count > 0) {
+		stats.p50 = find_percentile(0.5);
+		stats.p99 = find_percentile(0.99);
+		stats.p999 = find_percentile(0.999);
+	}
+	return stats;
+}
+
+uint64_t QueryTelemetry::GetNoResultCount() const {
+	const uint32_t first_slice = GetFirstSlice(GetCurrentSlice());
+	uint64_t no_result_count = 0;
+	for (size_t i = 0; i < SLICE_COUNT; ++i) {
+		no_result_count += slices_[i].no_result_count.Get(first_slice);
+	}
+	return no_result_count;
+}
+
+void QueryTelemetry::SliceCounter::Add(uint32_t slice) {
+	// the first to count for a newer slice restarts the count, a late request of an
+	// older slice is counted in the newer one
+	uint64_t value = value_.load(std::memory_order_relaxed);
+	while ((value >> 32) < slice) {
+		if (value_.compare_exchange_weak(value, (uint64_t{ slice } << 32) | 1, std::memory_order_relaxed)) {
+			return;
+		}
+	}
+	value_.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t QueryTelemetry::SliceCounter::Get(uint32_t first_slice) const {
+	const uint64_t value = value_.load(std::memory_order_relaxed);
+	return (value >> 32) >= first_slice ? value & 0xffffffffu : 0;
+}
+
+uint32_t QueryTelemetry::GetCurrentSlice() const {
+	return static_cast<uint32_t>((std::chrono::steady_clock::now() - start_) / slice_width_);
+}
+
+uint32_t QueryTelemetry::GetFirstSlice(uint32_t current_slice) {
+	return current_slice >= SLICE_COUNT - 1 ? current_slice - static_cast<uint32_t>(SLICE_COUNT - 1) : 0;
+}
+
+size_t QueryTelemetry::GetLatencyBin(uint64_t nanoseconds) {
+	if (nanoseconds < SUB_BIN_COUNT) {
+		return static_cast<size_t>(nanoseconds);
+	}
+	if (nanoseconds >= uint64_t{ 1 } << MAX_LATENCY_BITS) {
+		return LATENCY_BIN_COUNT - 1;
+	}
+	// the highest bit picks the power of two, the next SUB_BIN_BITS bits the bin in it
+	int exponent = MAX_LATENCY_BITS - 1;
+	while ((nanoseconds >> exponent) == 0) {
+		--exponent;
+	}
+	const size_t sub_bin = (nanoseconds >> (exponent - SUB_BIN_BITS)) & (SUB_BIN_COUNT - 1);
+	return (exponent - SUB_BIN_BITS + 1) * SUB_BIN_COUNT + sub_bin;
+}
+
+uint64_t QueryTelemetry::GetLatencyBinBound(size_t bin) {
+	if (bin < SUB_BIN_COUNT) {
+		return bin;
+	}
+	const int shift = static_cast<int>(bin / SUB_BIN_COUNT) - 1;
+	const uint64_t lower_bound = (SUB_BIN_COUNT + bin % SUB_BIN_COUNT) << shift;
+	return lower_bound + (uint64_t{ 1 } << shift) - 1;
+}
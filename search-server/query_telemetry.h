@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+struct QueryTelemetryStats {
+	uint64_t request_count = 0;
+	uint64_t no_result_count = 0;
+	double queries_per_second = 0.0;
+	// share of the requests that found nothing
+	double no_result_rate = 0.0;
+	// latency percentiles, each rounded up to the bound of its histogram bin
+	std::chrono::nanoseconds p50{ 0 };
+	std::chrono::nanoseconds p99{ 0 };
+	std::chrono::nanoseconds p999{ 0 };
+};
+
+// Request counts and a latency histogram over a sliding window of wall-clock time.
+// The window is a ring of SLICE_COUNT slices, a slice drops out of the window as a whole.
+// Every counter carries the number of the slice it counts for, and the first request
+// of a new slice restarts it, so Record only takes a few atomic operations and never
+// blocks, whatever number of threads record at once. Latencies go to log-linear bins
+// in the manner of HdrHistogram: 16 bins per power of two, within 6.25% of the value.
+class QueryTelemetry {
+public:
+	static constexpr size_t SLICE_COUNT = 60;
+
+	explicit QueryTelemetry(std::chrono::steady_clock::duration window);
+
+	void Record(std::chrono::steady_clock::duration latency, size_t result_count);
+
+	// over the window up to now, or since construction when that is shorter
+	QueryTelemetryStats GetStats() const;
+
+	uint64_t GetNoResultCount() const;
+
+private:
+	static constexpr int SUB_BIN_BITS = 4;
+	static constexpr size_t SUB_BIN_COUNT = size_t{ 1 } << SUB_BIN_BITS;
+	// bins up to 2^40 ns, about 18 minutes; longer latencies go to the last bin
+	static constexpr int MAX_LATENCY_BITS = 40;
+	static constexpr size_t LATENCY_BIN_COUNT = (MAX_LATENCY_BITS - SUB_BIN_BITS + 1) * SUB_BIN_COUNT;
+
+	// count in the low half, number of the slice it counts for in the high half
+	class SliceCounter {
+	public:
+		void Add(uint32_t slice);
+
+		// zero when the count is older than first_slice
+		uint64_t Get(uint32_t first_slice) const;
+
+	private:
+		std::atomic<uint64_t> value_{ 0 };
+	};
+
+	struct Slice {
+		SliceCounter request_count;
+		SliceCounter no_result_count;
+		SliceCounter latency_bins[LATENCY_BIN_COUNT];
+	};
+
+	const std::chrono::steady_clock::time_point start_;
+	const std::chrono::steady_clock::duration slice_width_;
+	std::unique_ptr<Slice[]> slices_;
+
+	uint32_t GetCurrentSlice() const;
+
+	// first slice of the window that ends with current_slice
+	static uint32_t GetFirstSlice(uint32_t current_slice);
+
+	static size_t GetLatencyBin(uint64_t nanoseconds);
+
+	// the largest latency of a bin
+	static uint64_t GetLatencyBinBound(size_t bin);
+};
@@ -1,36 +1,28 @@
 #include "request_queue.h"
 
-RequestQueue::RequestQueue(const SearchServer& search_server)
-		: search_server_(search_server), no_results_requests_(0), current_time_(0) {
+RequestQueue::RequestQueue(const SearchServer& search_server, std::chrono::steady_clock::duration window)
+		: search_server_(search_server), telemetry_(window) {
 }
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query,
 												   DocumentStatus status) {
+	const auto start = std::chrono::steady_clock::now();
 	const auto result = search_server_.FindTopDocuments(raw_query, status);
-	AddRequest(result.size());
+	telemetry_.Record(std::chrono::steady_clock::now() - start, result.size());
 	return result;
 }
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query) {
+	const auto start = std::chrono::steady_clock::now();
 	const auto result = search_server_.FindTopDocuments(raw_query);
-	AddRequest(result.size());
+	telemetry_.Record(std::chrono::steady_clock::now() - start, result.size());
 	return result;
 }
 
 int RequestQueue::GetNoResultRequests() const {
-	return no_results_requests_;
+	return static_cast<int>(telemetry_.GetNoResultCount());
 }
 
-void RequestQueue::AddRequest(int results_num) {
-	++current_time_;
-	while (!requests_.empty() && min_in_day_ <= current_time_ - requests_.front().timestamp) {
-		if (0 == requests_.front().results) {
-			--no_results_requests_;
-		}
-		requests_.pop_front();
-	}
-	requests_.push_back({current_time_, results_num});
-	if (0 == results_num) {
-		++no_results_requests_;
-	}
-}
\ No newline at end of file
+QueryTelemetryStats RequestQueue::GetStats() const {
+	return telemetry_.GetStats();
+}
@@ -2,14 +2,19 @@
 
 #include "search_server.h"
 #include "document.h"
+#include "query_telemetry.h"
 
+#include <chrono>
 #include <string>
 #include <vector>
-#include <stack>
 
+// Searches of a SearchServer with telemetry over a sliding window of wall-clock time:
+// requests per second, the share of requests without results and latency percentiles.
+// Requests from several threads are recorded without locks.
 class RequestQueue {
 public:
-	RequestQueue(const SearchServer& search_server);
+	explicit RequestQueue(const SearchServer& search_server,
+		std::chrono::steady_clock::duration window = std::chrono::hours(24));
 
 	template<typename DocumentPredicate>
 	std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate);
@@ -18,25 +23,20 @@ public:
 
 	std::vector<Document> AddFindRequest(const std::string& raw_query);
 
+	// requests without results within the window
 	int GetNoResultRequests() const;
 
+	QueryTelemetryStats GetStats() const;
+
 private:
-	struct QueryResult {
-		uint64_t timestamp;
-		int results;
-	};
-	std::deque<QueryResult> requests_;
 	const SearchServer& search_server_;
-	int no_results_requests_;
-	uint64_t current_time_;
-	const static int min_in_day_ = 1440;
-
-	void AddRequest(int results_num);
+	QueryTelemetry telemetry_;
 };
 
 template<typename DocumentPredicate>
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate) {
+	const auto start = std::chrono::steady_clock::now();
 	const auto result = search_server_.FindTopDocuments(raw_query, document_predicate);
-	AddRequest(result.size());
+	telemetry_.Record(std::chrono::steady_clock::now() - start, result.size());
 	return result;
-}
\ No newline at end of file
+}
@@ -0,0 +1,31 @@
+#include "search_limits.h"
+
+CancellationToken CancellationToken::Create() {
+	CancellationToken token;
+	token.is_cancelled_ = std::make_shared<std::atomic<bool>>(false);
+	return token;
+}
+
+void CancellationToken::Cancel() const {
+	if (is_cancelled_ != nullptr) {
+		is_cancelled_->store(true, std::memory_order_relaxed);
+	}
+}
+
+bool CancellationToken::IsCancelled() const {
+	return is_cancelled_ != nullptr && is_cancelled_->load(std::memory_order_relaxed);
+}
+
+SearchBudget::SearchBudget(const SearchLimits& limits)
+	: limits_(&limits) {
+}
+
+bool SearchBudget::Check() {
+	if (limits_ == nullptr || IsExhausted()) {
+		return IsExhausted();
+	}
+	if (limits_->cancellation.IsCancelled() || std::chrono::steady_clock::now() >= limits_->deadline) {
+		is_exhausted_.store(true, std::memory_order_relaxed);
+	}
+	return IsExhausted();
+}
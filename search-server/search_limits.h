@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+
+// Flag that stops the searches it was passed to. Copies share the flag, so the copy
+// kept by the caller cancels the search that got another one.
+class CancellationToken {
+public:
+	// a token that is never cancelled
+	CancellationToken() = default;
+
+	static CancellationToken Create();
+
+	void Cancel() const;
+
+	bool IsCancelled() const;
+
+private:
+	std::shared_ptr<std::atomic<bool>> is_cancelled_;
+};
+
+// When a search has to give up: at the deadline or once the token is cancelled,
+// whichever comes first. The default limits never stop a search.
+struct SearchLimits {
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+	CancellationToken cancellation;
+};
+
+// Limits as a search checks them. Reading the clock for every posting would cost more
+// than the posting, so searches count their work and check once per CHECK_INTERVAL
+// postings. Parallel parts of a search share one budget: once a check fails, every
+// part sees the budget exhausted.
+class SearchBudget {
+public:
+	static constexpr size_t CHECK_INTERVAL = 4096;
+
+	// a budget without limits
+	SearchBudget() = default;
+
+	explicit SearchBudget(const SearchLimits& limits);
+
+	// true once the search has to stop
+	bool Check();
+
+	bool IsExhausted() const {
+		return is_exhausted_.load(std::memory_order_relaxed);
+	}
+
+private:
+	const SearchLimits* limits_ = nullptr;
+	std::atomic<bool> is_exhausted_{ false };
+};
@@ -0,0 +1,46 @@
+#include "search_profile.h"
+
+SearchProfile::SearchProfile(const SearchProfile&) {
+}
+
+SearchProfile& SearchProfile::operator=(const SearchProfile& other) {
+	if (this != &other) {
+		Reset();
+	}
+	return *this;
+}
+
+void SearchProfile::AddPhase(SearchPhase phase, LogDuration::Clock::duration duration) {
+	const size_t index = static_cast<size_t>(phase);
+	phase_calls_[index].fetch_add(1, std::memory_order_relaxed);
+	phase_nanoseconds_[index].fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(),
+		std::memory_order_relaxed);
+}
+
+void SearchProfile::AddPostings(uint64_t count) {
+	postings_scanned_.fetch_add(count, std::memory_order_relaxed);
+}
+
+void SearchProfile::AddDocuments(uint64_t count) {
+	documents_scored_.fetch_add(count, std::memory_order_relaxed);
+}
+
+SearchProfileStats SearchProfile::GetStats() const {
+	SearchProfileStats stats;
+	for (size_t i = 0; i < SEARCH_PHASE_COUNT; ++i) {
+		stats.phases[i].calls = phase_calls_[i].load(std::memory_order_relaxed);
+		stats.phases[i].duration = std::chrono::nanoseconds(phase_nanoseconds_[i].load(std::memory_order_relaxed));
+	}
+	stats.postings_scanned = postings_scanned_.load(std::memory_order_relaxed);
+	stats.documents_scored = documents_scored_.load(std::memory_order_relaxed);
+	return stats;
+}
+
+void SearchProfile::Reset() {
+	for (size_t i = 0; i < SEARCH_PHASE_COUNT; ++i) {
+		phase_calls_[i].store(0, std::memory_order_relaxed);
+		phase_nanoseconds_[i].store(0, std::memory_order_relaxed);
+	}
+	postings_scanned_.store(0, std::memory_order_relaxed);
+	documents_scored_.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "log_duration.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Phases of a search. PARSE includes STOP_WORDS; parallel parts of a search add up
+// the time of every thread, so phases may sum up to more than the wall time.
+enum class SearchPhase {
+	PARSE,
+	STOP_WORDS,
+	// walk of the plus words; the dynamic pruning also probes the minus words in it
+	POSTINGS,
+	MINUS_WORDS,
+	// collecting the matched documents from the accumulators, or scoring the candidates
+	// of the impact-ordered walk exactly
+	MATERIALIZE,
+	// selecting and ordering the top
+	SORT,
+};
+
+const size_t SEARCH_PHASE_COUNT = 6;
+
+struct SearchProfileStats {
+	struct Phase {
+		uint64_t calls = 0;
+		std::chrono::nanoseconds duration{ 0 };
+	};
+
+	Phase phases[SEARCH_PHASE_COUNT];
+	// plus and minus word postings walked
+	uint64_t postings_scanned = 0;
+	// documents whose relevance was summed up
+	uint64_t documents_scored = 0;
+
+	const Phase& operator[](SearchPhase phase) const {
+		return phases[static_cast<size_t>(phase)];
+	}
+};
+
+// Timings and counters of the searches of a server, collected only when the build
+// defines SEARCH_SERVER_PROFILE: PROFILE_PHASE and PROFILE_COUNT compile to nothing
+// otherwise. Updates are relaxed atomic additions, safe from concurrent searches.
+// A copy starts from zero.
+class SearchProfile {
+public:
+	SearchProfile() = default;
+
+	SearchProfile(const SearchProfile&);
+
+	SearchProfile& operator=(const SearchProfile&);
+
+	void AddPhase(SearchPhase phase, LogDuration::Clock::duration duration);
+
+	void AddPostings(uint64_t count);
+
+	void AddDocuments(uint64_t count);
+
+	SearchProfileStats GetStats() const;
+
+	void Reset();
+
+private:
+	std::atomic<uint64_t> phase_calls_[SEARCH_PHASE_COUNT] = {};
+	std::atomic<uint64_t> phase_nanoseconds_[SEARCH_PHASE_COUNT] = {};
+	std::atomic<uint64_t> postings_scanned_{ 0 };
+	std::atomic<uint64_t> documents_scored_{ 0 };
+};
+
+// LogDuration that adds the time of its scope to a phase of a SearchProfile
+class PhaseDuration {
+public:
+	PhaseDuration(SearchProfile& profile, SearchPhase phase)
+			: profile_(profile)
+			, phase_(phase) {
+	}
+
+	~PhaseDuration() {
+		profile_.AddPhase(phase_, LogDuration::Clock::now() - start_time_);
+	}
+
+private:
+	SearchProfile& profile_;
+	const SearchPhase phase_;
+	const LogDuration::Clock::time_point start_time_ = LogDuration::Clock::now();
+};
+
+#ifdef SEARCH_SERVER_PROFILE
+#define PROFILE_PHASE(profile, phase) PhaseDuration UNIQUE_VAR_NAME_PROFILE(profile, phase)
+// counter is Postings or Documents
+#define PROFILE_COUNT(profile, counter, count) (profile).Add##counter(count)
+#else
+#define PROFILE_PHASE(profile, phase)
+#define PROFILE_COUNT(profile, counter, count)
+#endif
@@ -4,18 +4,19 @@
 
 #include "string_processing.h"
 #include "search_server.h"
+#include "index_snapshot.h"
 #include "read_input_functions.h"
 #include "log_duration.h"
 
 
 SearchServer::SearchServer(const std::string& stop_words_text)
-	: SearchServer(SplitIntoWords(stop_words_text))
+	: SearchServer(std::string_view(stop_words_text))
 {
 }
 
 
 SearchServer::SearchServer(const std::string_view stop_words_view)
-	: SearchServer(SplitIntoWords(stop_words_view))
+	: stop_words_(ParseStopWords(stop_words_view))
 {
 }
 
@@ -24,19 +25,76 @@ void SearchServer::AddDocument(int document_id, std::string_view document, Docum
 	const std::vector<int>& ratings) {
 	using namespace std::string_literals;
 
-	if ((document_id < 0) || (documents_.count(document_id) > 0)) {
+	if ((document_id < 0) || (document_ordinals_.count(document_id) > 0)) {
 		throw std::invalid_argument("Invalid document_id"s);
 	}
 
-	const auto [it, inserted] = documents_.emplace(document_id, DocumentData{ ComputeAverageRating(ratings), status, std::string(document) });
-	const auto words = SplitIntoWordsNoStop(it->second.doc_text);
+	auto word_freqs = ComputeWordFreqs(document);
+	AppendDocument(document_id, document, status, ComputeAverageRating(ratings), std::move(word_freqs));
+}
+
+void SearchServer::UpdateDocument(int document_id, std::string_view document, DocumentStatus status,
+	const std::vector<int>& ratings) {
+	using namespace std::string_literals;
+
+	const auto ordinal = FindOrdinal(document_id);
+	if (!ordinal) {
+		throw std::invalid_argument("Invalid document_id"s);
+	}
+	++generation_;
+	if (document == document_texts_[*ordinal]) {
+		documents_[*ordinal].rating = ComputeAverageRating(ratings);
+		documents_[*ordinal].status = status;
+		return;
+	}
 
-	const double inv_word_count = 1.0 / words.size();
-	for (std::string_view word : words) {
-		word_to_document_freqs_[word][document_id] += inv_word_count;
-		document_to_words_[document_id][word] = word_to_document_freqs_[word][document_id];
+	auto word_freqs = ComputeWordFreqs(document);
+	const std::vector<WordFreq>& old_word_freqs = document_to_words_[*ordinal];
+	const bool is_same_postings = std::equal(old_word_freqs.begin(), old_word_freqs.end(), word_freqs.begin(), word_freqs.end(),
+		[](const WordFreq& lhs, const WordFreq& rhs) {
+			return lhs.term_id == rhs.term_id && lhs.term_freq == rhs.term_freq;
+		});
+	if (!is_same_postings && *ordinal < tail_first_ordinal_) {
+		// sealed segments do not change: the document is removed and added to the tail again
+		ReleaseDocument(*ordinal);
+		AppendDocument(document_id, document, status, ComputeAverageRating(ratings), std::move(word_freqs));
+		return;
 	}
-	document_ids_.push_back(document_id);
+
+	// both lists are sorted by TermId, only the postings that differ are touched
+	auto old_it = old_word_freqs.begin();
+	auto new_it = word_freqs.begin();
+	while (old_it != old_word_freqs.end() || new_it != word_freqs.end()) {
+		if (new_it == word_freqs.end() || (old_it != old_word_freqs.end() && old_it->term_id < new_it->term_id)) {
+			word_to_document_freqs_[old_it->term_id].Erase(*ordinal);
+			--document_freqs_[old_it->term_id];
+			++term_versions_[old_it->term_id];
+			++old_it;
+		}
+		else if (old_it == old_word_freqs.end() || new_it->term_id < old_it->term_id) {
+			word_to_document_freqs_[new_it->term_id].SetTermFreq(*ordinal, new_it->term_freq);
+			++document_freqs_[new_it->term_id];
+			++term_versions_[new_it->term_id];
+			++new_it;
+		}
+		else {
+			if (old_it->term_freq != new_it->term_freq) {
+				word_to_document_freqs_[new_it->term_id].SetTermFreq(*ordinal, new_it->term_freq);
+				++term_versions_[new_it->term_id];
+			}
+			++old_it;
+			++new_it;
+		}
+	}
+
+	documents_[*ordinal].rating = ComputeAverageRating(ratings);
+	documents_[*ordinal].status = status;
+	document_texts_.Set(*ordinal, document);
+	document_to_words_[*ordinal] = std::move(word_freqs);
+}
+
+void SearchServer::AddDocuments(const std::vector<NewDocument>& documents) {
+	AddDocuments(std::execution::seq, documents);
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
@@ -50,20 +108,283 @@ std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query)
 	return FindTopDocuments(std::execution::seq, raw_query, DocumentStatus::ACTUAL);
 }
 
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status, size_t document_count) const {
+	return FindTopDocuments(std::execution::seq,
+		raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
+			return document_status == status;
+		}, document_count);
+}
+
+SearchResult SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status, const SearchLimits& limits) const {
+	return FindTopDocuments(std::execution::seq, raw_query, status, limits);
+}
+
+SearchResult SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status, const SearchLimits& limits,
+	size_t document_count) const {
+	return FindTopDocuments(std::execution::seq, raw_query, status, limits, document_count);
+}
+
+std::vector<std::vector<Document>> SearchServer::FindTopDocumentsBatch(const std::vector<std::string_view>& queries) const {
+	std::vector<std::vector<Document>> result(queries.size());
+	if (ranking_mode_ != RankingMode::EXHAUSTIVE) {
+		// parsed up front, so an invalid query throws here instead of inside the parallel algorithm
+		std::vector<Query> parsed_queries;
+		parsed_queries.reserve(queries.size());
+		for (std::string_view query : queries) {
+			parsed_queries.push_back(ParseQuery(query, false));
+		}
+		std::transform(std::execution::par, parsed_queries.begin(), parsed_queries.end(), result.begin(),
+			[this](const Query& query) {
+				SearchBudget budget;
+				return FindTopDocumentsWithin(std::execution::seq, query,
+					[](int, DocumentStatus document_status, int) {
+						return document_status == DocumentStatus::ACTUAL;
+					}, max_result_document_count_, budget);
+			});
+		return result;
+	}
+
+	// words of the queries as indexes of the distinct live terms of the batch, plus words
+	// sorted as FindTopDocuments sums them
+	struct BatchQuery {
+		std::vector<uint32_t> plus_terms;
+		std::vector<uint32_t> minus_terms;
+	};
+	struct BatchPosting {
+		DocumentOrdinal ordinal;
+		double term_freq;
+	};
+	std::vector<BatchQuery> batch_queries(queries.size());
+	std::unordered_map<TermId, uint32_t> term_indexes;
+	std::vector<SegmentedPostings> term_postings;
+	std::vector<double> inverse_document_freqs;
+	for (size_t i = 0; i < queries.size(); ++i) {
+		const Query query = ParseQuery(queries[i], false);
+		for (auto [words, terms] : { std::pair{ &query.plus_words, &batch_queries[i].plus_terms },
+			std::pair{ &query.minus_words, &batch_queries[i].minus_terms } }) {
+			for (std::string_view word : *words) {
+				const TermId term_id = FindLiveTerm(word);
+				if (term_id == TermDictionary::NO_TERM) {
+					continue;
+				}
+				const auto [it, is_new] = term_indexes.emplace(term_id, static_cast<uint32_t>(term_postings.size()));
+				if (is_new) {
+					term_postings.push_back(GetPostings(term_id));
+					inverse_document_freqs.push_back(ComputeWordInverseDocumentFreq(document_freqs_[term_id]));
+				}
+				terms->push_back(it->second);
+			}
+		}
+	}
+
+	std::vector<SegmentedPostingCursor> cursors(term_postings.begin(), term_postings.end());
+	std::vector<std::vector<BatchPosting>> range_postings(term_postings.size());
+	std::vector<TopDocuments> top_documents(queries.size(), TopDocuments(max_result_document_count_));
+	std::vector<size_t> term_indexes_in_order(term_postings.size());
+	std::iota(term_indexes_in_order.begin(), term_indexes_in_order.end(), 0);
+	// Every chunk of queries reuses its accumulators over all ranges. A query records the
+	// ordinals it touched and materializes and clears only those, so it costs its share of
+	// the postings and not the size of the range.
+	struct ChunkAccumulators {
+		std::vector<double> document_to_relevance;
+		// 0 untouched, 1 matched, 2 excluded by a minus word
+		std::vector<char> states;
+		std::vector<DocumentOrdinal> touched_ordinals;
+	};
+	const size_t chunk_count = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency() * 4, queries.size()));
+	const size_t chunk_size = (queries.size() + chunk_count - 1) / chunk_count;
+	std::vector<size_t> chunk_indexes(chunk_count);
+	std::iota(chunk_indexes.begin(), chunk_indexes.end(), 0);
+	std::vector<ChunkAccumulators> chunk_accumulators(chunk_count);
+
+	// Only postings of live ACTUAL documents are kept, the others match no query.
+	for (DocumentOrdinal first = 0; first < documents_.size(); first += BATCH_RANGE_SIZE) {
+		const DocumentOrdinal last = static_cast<DocumentOrdinal>(std::min<size_t>(first + BATCH_RANGE_SIZE, documents_.size()));
+		std::for_each(std::execution::par, term_indexes_in_order.begin(), term_indexes_in_order.end(),
+			[&](size_t term_index) {
+				SegmentedPostingCursor& cursor = cursors[term_index];
+				std::vector<BatchPosting>& postings = range_postings[term_index];
+				PROFILE_PHASE(profile_, SearchPhase::POSTINGS);
+				postings.clear();
+				size_t posting_count = 0;
+				for (; cursor.GetOrdinal() < last; cursor.Next()) {
+					++posting_count;
+					const DocumentData& document_data = documents_[cursor.GetOrdinal()];
+					if (!document_data.is_removed && document_data.status == DocumentStatus::ACTUAL) {
+						postings.push_back({ cursor.GetOrdinal(), cursor.GetTermFreq() });
+					}
+				}
+				PROFILE_COUNT(profile_, Postings, posting_count);
+			});
+		std::for_each(std::execution::par, chunk_indexes.begin(), chunk_indexes.end(),
+			[&](size_t chunk_index) {
+				auto& [document_to_relevance, states, touched_ordinals] = chunk_accumulators[chunk_index];
+				if (states.empty()) {
+					document_to_relevance.assign(std::min<size_t>(BATCH_RANGE_SIZE, documents_.size()), 0.0);
+					states.assign(document_to_relevance.size(), 0);
+				}
+				const size_t first_query = std::min(chunk_index * chunk_size, queries.size());
+				const size_t last_query = std::min(first_query + chunk_size, queries.size());
+				for (size_t query_index = first_query; query_index < last_query; ++query_index) {
+					const BatchQuery& query = batch_queries[query_index];
+					{
+						PROFILE_PHASE(profile_, SearchPhase::POSTINGS);
+						for (const uint32_t term_index : query.plus_terms) {
+							const double inverse_document_freq = inverse_document_freqs[term_index];
+							for (const auto [ordinal, term_freq] : range_postings[term_index]) {
+								document_to_relevance[ordinal - first] += term_freq * inverse_document_freq;
+								if (states[ordinal - first] == 0) {
+									states[ordinal - first] = 1;
+									touched_ordinals.push_back(ordinal);
+								}
+							}
+						}
+					}
+					{
+						PROFILE_PHASE(profile_, SearchPhase::MINUS_WORDS);
+						for (const uint32_t term_index : query.minus_terms) {
+							for (const BatchPosting& posting : range_postings[term_index]) {
+								if (states[posting.ordinal - first] == 1) {
+									states[posting.ordinal - first] = 2;
+								}
+							}
+						}
+					}
+					{
+						PROFILE_PHASE(profile_, SearchPhase::MATERIALIZE);
+						size_t scored_count = 0;
+						for (const DocumentOrdinal ordinal : touched_ordinals) {
+							if (states[ordinal - first] == 1) {
+								top_documents[query_index].Push({ documents_[ordinal].id, document_to_relevance[ordinal - first], documents_[ordinal].rating });
+								++scored_count;
+							}
+							document_to_relevance[ordinal - first] = 0.0;
+							states[ordinal - first] = 0;
+						}
+						touched_ordinals.clear();
+						PROFILE_COUNT(profile_, Documents, scored_count);
+					}
+				}
+			});
+	}
+
+	PROFILE_PHASE(profile_, SearchPhase::SORT);
+	for (size_t i = 0; i < queries.size(); ++i) {
+		result[i] = top_documents[i].Extract();
+	}
+	return result;
+}
+
+void SearchServer::SetMaxResultDocumentCount(size_t document_count) {
+	++generation_;
+	max_result_document_count_ = document_count;
+}
+
+size_t SearchServer::GetMaxResultDocumentCount() const {
+	return max_result_document_count_;
+}
+
+void SearchServer::SetRankingMode(RankingMode ranking_mode) {
+	ranking_mode_ = ranking_mode;
+}
+
+RankingMode SearchServer::GetRankingMode() const {
+	return ranking_mode_;
+}
+
+void SearchServer::CompressPostings() {
+	if (pending_merge_.valid()) {
+		const SegmentMerge merge = pending_merge_.get();
+		pending_merge_ = {};
+		InstallMerge(merge);
+	}
+	if (tail_first_ordinal_ < documents_.size()) {
+		SealTail();
+	}
+	if (!segments_.empty()) {
+		StartMerge(0, segments_.size(), true, false);
+	}
+}
+
+bool SearchServer::IsCompressed() const {
+	return tail_first_ordinal_ == documents_.size();
+}
+
+void SearchServer::FreezeTerms() {
+	terms_.Freeze();
+}
+
+SearchProfileStats SearchServer::GetProfile() const {
+	return profile_.GetStats();
+}
+
+void SearchServer::ResetProfile() {
+	profile_.Reset();
+}
+
+PostingMemoryUsage SearchServer::GetPostingMemoryUsage() const {
+	PostingMemoryUsage usage;
+	for (const auto& segment : segments_) {
+		usage.posting_count += segment->GetPostingCount();
+		usage.bytes += segment->GetMemoryUsage();
+	}
+	for (const PostingList& postings : word_to_document_freqs_) {
+		usage.posting_count += postings.size();
+		usage.bytes += postings.GetMemoryUsage();
+	}
+	usage.bytes += (word_to_document_freqs_.capacity() - word_to_document_freqs_.size()) * sizeof(PostingList);
+	return usage;
+}
+
+TextMemoryUsage SearchServer::GetTextMemoryUsage() const {
+	return { document_texts_.GetMemoryUsage(), terms_.GetMemoryUsage() };
+}
+
+uint64_t SearchServer::GetGeneration() const {
+	return generation_;
+}
+
+std::string SearchServer::GetCanonicalQuery(std::string_view raw_query) const {
+	const Query query = ParseQuery(raw_query, false);
+	std::string result;
+	for (std::string_view word : query.plus_words) {
+		if (!result.empty()) {
+			result += ' ';
+		}
+		result += word;
+	}
+	for (std::string_view word : query.minus_words) {
+		if (!result.empty()) {
+			result += ' ';
+		}
+		result += '-';
+		result += word;
+	}
+	return result;
+}
+
 int SearchServer::GetDocumentCount() const {
-	return documents_.size();
+	return static_cast<int>(documents_.size() - removed_document_count_);
 }
 
 int SearchServer::GetDocumentId(int index) const {
-	return document_ids_.at(index);
+	using namespace std::string_literals;
+
+	if (index < 0 || index >= GetDocumentCount()) {
+		throw std::out_of_range("Invalid document index"s);
+	}
+	if (removed_document_count_ == 0) {
+		return documents_[index].id;
+	}
+	return documents_[live_ordinals_.Select(index)].id;
 }
 
-std::vector<int>::const_iterator SearchServer::begin() const {
-	return document_ids_.begin();
+SearchServer::DocumentIdIterator SearchServer::begin() const {
+	return { documents_.data(), documents_.data() + documents_.size() };
 }
 
-std::vector<int>::const_iterator SearchServer::end() const {
-	return document_ids_.end();
+SearchServer::DocumentIdIterator SearchServer::end() const {
+	return { documents_.data() + documents_.size(), documents_.data() + documents_.size() };
 }
 
 SearchServer::MatchDocumentResult SearchServer::MatchDocument(std::string_view raw_query, int document_id) const {
@@ -73,28 +394,22 @@ SearchServer::MatchDocumentResult SearchServer::MatchDocument(std::string_view r
 SearchServer::MatchDocumentResult SearchServer::MatchDocument(const std::execution::sequenced_policy&,
 	std::string_view raw_query, int document_id) const {
 
-	if (!documents_.count(document_id)) {
+	const auto ordinal = FindOrdinal(document_id);
+	if (!ordinal) {
 		using namespace std::literals::string_literals;
 		throw std::out_of_range("incorrect document id"s);
 	}
-	using namespace std;
 	bool skip_sort = false;
 	const auto query = ParseQuery(raw_query, skip_sort);
-	const auto status = documents_.at(document_id).status;
+	const auto status = documents_[*ordinal].status;
 	for (const std::string_view word : query.minus_words) {
-		if (word_to_document_freqs_.count(word) == 0) {
-			continue;
-		}
-		if (word_to_document_freqs_.at(word).count(document_id)) {
-			return { {}, status };
+		if (ContainsWord(word, *ordinal)) {
+			return { std::vector<std::string_view>{}, status };
 		}
 	}
 	std::vector<std::string_view> matched_words;
 	for (const std::string_view word : query.plus_words) {
-		if (word_to_document_freqs_.count(word) == 0) {
-			continue;
-		}
-		if (word_to_document_freqs_.at(word).count(document_id)) {
+		if (ContainsWord(word, *ordinal)) {
 			matched_words.push_back(word);
 		}
 	}
@@ -104,22 +419,22 @@ SearchServer::MatchDocumentResult SearchServer::MatchDocument(const std::executi
 SearchServer::MatchDocumentResult SearchServer::MatchDocument(const std::execution::parallel_policy&,
 	std::string_view raw_query, int document_id) const {
 
-	if (documents_.count(document_id) == 0) {
+	const auto ordinal = FindOrdinal(document_id);
+	if (!ordinal) {
 		using namespace std::literals::string_literals;
 		throw std::out_of_range("document_id incorrect!"s);
 	}
 	bool skip_sort = true;
 	const auto query = ParseQuery(raw_query, skip_sort);
-	const auto status = documents_.at(document_id).status;
+	const auto status = documents_[*ordinal].status;
 
-	const auto word_checker = [this, document_id](const std::string_view word) {
-		const auto it = word_to_document_freqs_.find(word);
-		return it != word_to_document_freqs_.end() && it->second.count(document_id);
+	const auto word_checker = [this, ordinal = *ordinal](const std::string_view word) {
+		return ContainsWord(word, ordinal);
 	};
 
 	if (std::any_of(std::execution::par, query.minus_words.begin(), query.minus_words.end(),
 		word_checker)) {
-		return { {}, status };
+		return { std::vector<std::string_view>{}, status };
 	}
 	std::vector<std::string_view> matched_words(query.plus_words.size());
 
@@ -134,19 +449,201 @@ SearchServer::MatchDocumentResult SearchServer::MatchDocument(const std::executi
 
 void SearchServer::RemoveDocument(int document_id)
 {
-	if (documents_.count(document_id) == 0) {
+	const auto ordinal = FindOrdinal(document_id);
+	if (!ordinal) {
 		return;
 	}
-	documents_.erase(document_id);
-	auto new_end_it = std::remove(document_ids_.begin(), document_ids_.end(), document_id);
-	document_ids_.erase(new_end_it, document_ids_.end());
+	ReleaseDocument(*ordinal);
+}
+
+void SearchServer::ReleaseDocument(DocumentOrdinal ordinal) {
+	++generation_;
+	for (const WordFreq& word_freq : document_to_words_[ordinal]) {
+		--document_freqs_[word_freq.term_id];
+	}
+	document_ordinals_.erase(documents_[ordinal].id);
+	documents_[ordinal].is_removed = true;
+	live_ordinals_.Remove(ordinal);
+	document_texts_.Clear(ordinal);
+	std::vector<WordFreq>().swap(document_to_words_[ordinal]);
+	++removed_document_count_;
+	MaintainSegments();
+}
 
-	for (auto& [word, submap] : word_to_document_freqs_) {
-		if (submap.count(document_id) > 0) {
-			submap.erase(document_id);
+void SearchServer::CompactOrdinals(const std::vector<DocumentOrdinal>& new_ordinals) {
+	DocumentOrdinal next_ordinal = 0;
+	for (DocumentOrdinal ordinal = 0; ordinal < documents_.size(); ++ordinal) {
+		if (new_ordinals[ordinal] == NO_ORDINAL) {
+			--removed_document_count_;
+			continue;
+		}
+		if (next_ordinal != ordinal) {
+			documents_[next_ordinal] = documents_[ordinal];
+			document_texts_.Move(ordinal, next_ordinal);
+			document_to_words_[next_ordinal] = std::move(document_to_words_[ordinal]);
+			if (!documents_[next_ordinal].is_removed) {
+				document_ordinals_[documents_[next_ordinal].id] = next_ordinal;
+			}
 		}
+		++next_ordinal;
+	}
+	documents_.resize(next_ordinal);
+	document_texts_.Truncate(next_ordinal);
+	document_to_words_.resize(next_ordinal);
+	std::vector<bool> is_live(next_ordinal);
+	for (DocumentOrdinal ordinal = 0; ordinal < next_ordinal; ++ordinal) {
+		is_live[ordinal] = !documents_[ordinal].is_removed;
+	}
+	live_ordinals_.Assign(is_live);
+
+	for (PostingList& postings : word_to_document_freqs_) {
+		postings.RenumberOrdinals(new_ordinals);
 	}
-	document_to_words_.erase(document_id);
+	impact_index_.Clear();
+}
+
+void SearchServer::MaintainSegments() {
+	using namespace std::chrono_literals;
+
+	if (pending_merge_.valid()) {
+		if (pending_merge_.wait_for(0s) != std::future_status::ready) {
+			return;
+		}
+		const SegmentMerge merge = pending_merge_.get();
+		pending_merge_ = {};
+		InstallMerge(merge);
+	}
+
+	if (documents_.size() - tail_first_ordinal_ >= SEGMENT_DOCUMENT_COUNT) {
+		SealTail();
+	}
+	// holes are squeezed out once they outnumber the live documents, which keeps
+	// the amortized cost of a removal proportional to the document's own postings
+	if (removed_document_count_ * 2 > documents_.size()) {
+		if (tail_first_ordinal_ < documents_.size()) {
+			SealTail();
+		}
+		StartMerge(0, segments_.size(), true, true);
+		return;
+	}
+	if (segments_.size() >= SEGMENT_MERGE_FACTOR) {
+		// size tiers grow by SEGMENT_MERGE_FACTOR, the last segments are always the smallest
+		const auto get_tier = [](const IndexSegment& segment) {
+			int tier = 0;
+			for (size_t size = (segment.GetLastOrdinal() - segment.GetFirstOrdinal()) / SEGMENT_DOCUMENT_COUNT;
+				size >= SEGMENT_MERGE_FACTOR; size /= SEGMENT_MERGE_FACTOR) {
+				++tier;
+			}
+			return tier;
+		};
+		const size_t first_segment = segments_.size() - SEGMENT_MERGE_FACTOR;
+		const int tier = get_tier(*segments_.back());
+		if (std::all_of(segments_.begin() + first_segment, segments_.end(), [&](const auto& segment) {
+			return get_tier(*segment) == tier;
+			})) {
+			StartMerge(first_segment, SEGMENT_MERGE_FACTOR, false, true);
+		}
+	}
+}
+
+void SearchServer::SealTail() {
+	const DocumentOrdinal last_ordinal = static_cast<DocumentOrdinal>(documents_.size());
+	std::vector<bool> is_removed(last_ordinal);
+	for (DocumentOrdinal ordinal = tail_first_ordinal_; ordinal < last_ordinal; ++ordinal) {
+		is_removed[ordinal] = documents_[ordinal].is_removed;
+	}
+	segments_.push_back(SealSegment(word_to_document_freqs_, tail_first_ordinal_, last_ordinal, is_removed));
+	std::vector<PostingList>(word_to_document_freqs_.size()).swap(word_to_document_freqs_);
+	tail_first_ordinal_ = last_ordinal;
+}
+
+void SearchServer::StartMerge(size_t first_segment, size_t segment_count, bool compact, bool is_background) {
+	std::vector<std::shared_ptr<const IndexSegment>> segments(segments_.begin() + first_segment,
+		segments_.begin() + first_segment + segment_count);
+	// the merge sees the removals made until now, later ones stay marked in documents_
+	std::vector<bool> is_removed(segments.back()->GetLastOrdinal());
+	for (DocumentOrdinal ordinal = segments.front()->GetFirstOrdinal(); ordinal < is_removed.size(); ++ordinal) {
+		is_removed[ordinal] = documents_[ordinal].is_removed;
+	}
+
+	auto merge = [first_segment, segment_count, compact, segments = std::move(segments), is_removed = std::move(is_removed)]() {
+		std::vector<DocumentOrdinal> new_ordinals;
+		if (compact) {
+			new_ordinals.assign(is_removed.size(), NO_ORDINAL);
+			DocumentOrdinal next_ordinal = 0;
+			for (DocumentOrdinal ordinal = 0; ordinal < is_removed.size(); ++ordinal) {
+				if (!is_removed[ordinal]) {
+					new_ordinals[ordinal] = next_ordinal++;
+				}
+			}
+		}
+		std::shared_ptr<const IndexSegment> segment = MergeSegments(segments, is_removed, new_ordinals);
+		return SegmentMerge{ first_segment, segment_count, std::move(segment), std::move(new_ordinals) };
+	};
+	if (is_background) {
+		pending_merge_ = std::async(std::launch::async, std::move(merge)).share();
+	}
+	else {
+		InstallMerge(merge());
+	}
+}
+
+void SearchServer::InstallMerge(const SegmentMerge& merge) {
+	// nothing is sealed while a merge runs, so its segments are still where they were
+	segments_.erase(segments_.begin() + merge.first_segment + 1, segments_.begin() + merge.first_segment + merge.segment_count);
+	segments_[merge.first_segment] = merge.segment;
+	if (merge.new_ordinals.empty()) {
+		return;
+	}
+
+	// a compacting merge covers every sealed segment; the tail moves down behind it
+	const DocumentOrdinal shift = tail_first_ordinal_ - merge.segment->GetLastOrdinal();
+	std::vector<DocumentOrdinal> new_ordinals = merge.new_ordinals;
+	new_ordinals.reserve(documents_.size());
+	for (DocumentOrdinal ordinal = tail_first_ordinal_; ordinal < documents_.size(); ++ordinal) {
+		new_ordinals.push_back(ordinal - shift);
+	}
+	CompactOrdinals(new_ordinals);
+	tail_first_ordinal_ -= shift;
+}
+
+void SearchServer::SaveSnapshot(const std::string& path) const {
+	IndexSnapshotData data;
+	data.stop_words = stop_words_.GetWords();
+	data.max_result_document_count = max_result_document_count_;
+
+	// the holes of removed documents are squeezed out on the way
+	std::vector<DocumentOrdinal> new_ordinals(documents_.size());
+	for (DocumentOrdinal ordinal = 0; ordinal < documents_.size(); ++ordinal) {
+		const DocumentData& document = documents_[ordinal];
+		if (!document.is_removed) {
+			new_ordinals[ordinal] = static_cast<DocumentOrdinal>(data.documents.size());
+			data.documents.push_back({ document.id, document.rating, static_cast<int32_t>(document.status) });
+			data.texts.push_back(document_texts_[ordinal]);
+		}
+	}
+
+	std::vector<TermId> term_ids;
+	for (TermId term_id = 0; term_id < terms_.size(); ++term_id) {
+		if (document_freqs_[term_id] > 0) {
+			term_ids.push_back(term_id);
+		}
+	}
+	std::sort(term_ids.begin(), term_ids.end(), [this](TermId lhs, TermId rhs) {
+		return terms_.GetTerm(lhs) < terms_.GetTerm(rhs);
+	});
+	data.posting_offsets.push_back(0);
+	for (const TermId term_id : term_ids) {
+		for (SegmentedPostingCursor cursor(GetPostings(term_id)); !cursor.IsEnd(); cursor.Next()) {
+			if (!documents_[cursor.GetOrdinal()].is_removed) {
+				data.ordinals.push_back(new_ordinals[cursor.GetOrdinal()]);
+				data.term_freqs.push_back(cursor.GetTermFreq());
+			}
+		}
+		data.terms.push_back(terms_.GetTerm(term_id));
+		data.posting_offsets.push_back(data.ordinals.size());
+	}
+	WriteIndexSnapshot(path, data);
 }
 
 const std::map<std::string_view, double>& SearchServer::GetWordFrequencies(int document_id) const
@@ -154,37 +651,42 @@ const std::map<std::string_view, double>& SearchServer::GetWordFrequencies(int d
 	static std::map<std::string_view, double> word_freqs_;
 	word_freqs_.clear();
 
-	if (documents_.count(document_id) > 0) {
-		word_freqs_ = document_to_words_.at(document_id);
+	const auto ordinal = FindOrdinal(document_id);
+	if (ordinal) {
+		for (const auto [term_id, term_freq] : document_to_words_[*ordinal]) {
+			word_freqs_.emplace(terms_.GetTerm(term_id), term_freq);
+		}
 	}
 	return word_freqs_;
 }
 
 bool SearchServer::IsStopWord(std::string_view word) const {
-	return stop_words_.count(word) > 0;
+	return stop_words_.Contains(word);
 }
 
 
-bool SearchServer::IsValidWord(std::string_view word) {
-	return std::none_of(word.begin(), word.end(), [](char c) {
-		return c >= '\0' && c < ' ';
+FrozenWordSet SearchServer::ParseStopWords(std::string_view text) {
+	using namespace std::string_literals;
+
+	std::vector<std::string_view> stop_words;
+	ForEachWord(text, [&stop_words](std::string_view word, bool is_valid) {
+		if (!is_valid) {
+			throw std::invalid_argument("Some of stop words are invalid"s);
+		}
+		if (!word.empty()) {
+			stop_words.push_back(word);
+		}
 		});
+	return FrozenWordSet(std::move(stop_words));
 }
 
-
-std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(std::string_view text) const {
+FrozenWordSet SearchServer::FreezeStopWords(const std::set<std::string, std::less<>>& stop_words) {
 	using namespace std::string_literals;
 
-	std::vector<std::string_view> words;
-	for (std::string_view word : SplitIntoWords(text)) {
-		if (!IsValidWord(word)) {
-			throw std::invalid_argument("Word "s + word.data() + " is invalid"s);
-		}
-		if (!IsStopWord(word)) {
-			words.push_back(word);
-		}
+	if (!std::all_of(stop_words.begin(), stop_words.end(), IsValidWord)) {
+		throw std::invalid_argument("Some of stop words are invalid"s);
 	}
-	return words;
+	return FrozenWordSet(std::vector<std::string_view>(stop_words.begin(), stop_words.end()));
 }
 
 int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
@@ -192,7 +694,126 @@ int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
 	return rating_sum / static_cast<int>(ratings.size());
 }
 
-SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) const {
+std::vector<SearchServer::WordFreq> SearchServer::ComputeWordFreqs(std::string_view document) {
+	const ParsedDocument parsed_document = ParseDocument(document);
+	if (parsed_document.error) {
+		std::rethrow_exception(parsed_document.error);
+	}
+	return InternWordFreqs(parsed_document);
+}
+
+std::vector<SearchServer::WordFreq> SearchServer::InternWordFreqs(const ParsedDocument& parsed_document) {
+	std::vector<WordFreq> word_freqs;
+	word_freqs.reserve(parsed_document.word_freqs.size() + parsed_document.new_word_freqs.size());
+	word_freqs = parsed_document.word_freqs;
+	// words unknown at parse time may have been added since, by an earlier document of a batch
+	for (const auto& [word, term_freq] : parsed_document.new_word_freqs) {
+		const TermId term_id = terms_.Intern(word);
+		if (term_id == word_to_document_freqs_.size()) {
+			word_to_document_freqs_.emplace_back();
+			document_freqs_.push_back(0);
+			term_versions_.push_back(0);
+		}
+		word_freqs.push_back({ term_id, term_freq });
+	}
+	if (!parsed_document.new_word_freqs.empty()) {
+		std::sort(word_freqs.begin(), word_freqs.end(), [](const WordFreq& lhs, const WordFreq& rhs) {
+			return lhs.term_id < rhs.term_id;
+		});
+	}
+	return word_freqs;
+}
+
+void SearchServer::AppendDocument(int document_id, std::string_view document, DocumentStatus status, int rating,
+	std::vector<WordFreq> word_freqs) {
+	++generation_;
+	const DocumentOrdinal ordinal = static_cast<DocumentOrdinal>(documents_.size());
+	documents_.push_back({ document_id, rating, status, false });
+	live_ordinals_.PushBack();
+	document_texts_.PushBack(document);
+	document_ordinals_.emplace(document_id, ordinal);
+	for (const WordFreq& word_freq : word_freqs) {
+		word_to_document_freqs_[word_freq.term_id].AddTermFreq(ordinal, word_freq.term_freq);
+		++document_freqs_[word_freq.term_id];
+		++term_versions_[word_freq.term_id];
+	}
+	document_to_words_.push_back(std::move(word_freqs));
+	MaintainSegments();
+}
+
+SearchServer::ParsedDocument SearchServer::ParseDocument(std::string_view text) const {
+	ParsedDocument result;
+	try {
+		std::vector<TermId> term_ids;
+		std::vector<std::string_view> new_words;
+		ForEachWordNoStop(text, [this, &term_ids, &new_words](std::string_view word) {
+			const TermId term_id = terms_.Find(word);
+			if (term_id == TermDictionary::NO_TERM) {
+				new_words.push_back(word);
+			}
+			else {
+				term_ids.push_back(term_id);
+			}
+			});
+		const double inv_word_count = 1.0 / (term_ids.size() + new_words.size());
+		std::sort(term_ids.begin(), term_ids.end());
+		std::sort(new_words.begin(), new_words.end());
+
+		// frequencies are summed one occurrence at a time
+		for (const TermId term_id : term_ids) {
+			if (result.word_freqs.empty() || result.word_freqs.back().term_id != term_id) {
+				result.word_freqs.push_back({ term_id, 0.0 });
+			}
+			result.word_freqs.back().term_freq += inv_word_count;
+		}
+		for (std::string_view word : new_words) {
+			if (result.new_word_freqs.empty() || result.new_word_freqs.back().first != word) {
+				result.new_word_freqs.push_back({ word, 0.0 });
+			}
+			result.new_word_freqs.back().second += inv_word_count;
+		}
+	}
+	catch (...) {
+		result.error = std::current_exception();
+	}
+	return result;
+}
+
+std::exception_ptr SearchServer::AppendDocuments(std::vector<NewDocument>::const_iterator first,
+	std::vector<NewDocument>::const_iterator last, const std::vector<ParsedDocument>& parsed_documents) {
+	using namespace std::string_literals;
+
+	const size_t count = last - first;
+	documents_.reserve(documents_.size() + count);
+	document_texts_.Reserve(document_texts_.size() + count);
+	document_to_words_.reserve(document_to_words_.size() + count);
+	for (size_t i = 0; i < count; ++i) {
+		const NewDocument& document = first[i];
+		const ParsedDocument& parsed_document = parsed_documents[i];
+		if ((document.id < 0) || (document_ordinals_.count(document.id) > 0)) {
+			return std::make_exception_ptr(std::invalid_argument("Invalid document_id"s));
+		}
+		if (parsed_document.error) {
+			return parsed_document.error;
+		}
+
+		++generation_;
+		const DocumentOrdinal ordinal = static_cast<DocumentOrdinal>(documents_.size());
+		documents_.push_back({ document.id, ComputeAverageRating(document.ratings), document.status, false });
+		live_ordinals_.PushBack();
+		document_texts_.PushBack(document.text);
+		document_ordinals_.emplace(document.id, ordinal);
+
+		const auto& word_freqs = document_to_words_.emplace_back(InternWordFreqs(parsed_document));
+		for (const WordFreq& word_freq : word_freqs) {
+			++document_freqs_[word_freq.term_id];
+			++term_versions_[word_freq.term_id];
+		}
+	}
+	return nullptr;
+}
+
+SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text, bool is_valid) const {
 	using namespace std::string_literals;
 
 	if (text.empty()) {
@@ -204,17 +825,19 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view text) cons
 		is_minus = true;
 		word = word.substr(1);
 	}
-	if (word.empty() || word[0] == '-' || !IsValidWord(word)) {
+	if (word.empty() || word[0] == '-' || !is_valid) {
 		throw std::invalid_argument("Query word "s + text.data() + " is invalid"s);
 	}
+	PROFILE_PHASE(profile_, SearchPhase::STOP_WORDS);
 	return { word, is_minus, IsStopWord(word) };
 }
 
 SearchServer::Query SearchServer::ParseQuery(std::string_view text, bool skip_sort) const {
+	PROFILE_PHASE(profile_, SearchPhase::PARSE);
 	Query result;
 
-	for (const std::string_view word : SplitIntoWords(text)) {
-		const auto query_word = ParseQueryWord(word);
+	ForEachWord(text, [this, &result](std::string_view word, bool is_valid) {
+		const auto query_word = ParseQueryWord(word, is_valid);
 		if (!query_word.is_stop) {
 			if (query_word.is_minus) {
 				result.minus_words.push_back(query_word.data);
@@ -223,7 +846,7 @@ SearchServer::Query SearchServer::ParseQuery(std::string_view text, bool skip_so
 				result.plus_words.push_back(query_word.data);
 			}
 		}
-	}
+		});
 
 	if (!skip_sort) {
 		for (auto* words : { &result.plus_words, &result.minus_words }) {
@@ -234,6 +857,83 @@ SearchServer::Query SearchServer::ParseQuery(std::string_view text, bool skip_so
 	return result;
 }
 
-double SearchServer::ComputeWordInverseDocumentFreq(std::string_view word) const {
-	return std::log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+std::unique_ptr<SearchServer::ImpactScratch> SearchServer::AcquireImpactScratch(size_t ordinal_count) {
+	std::unique_ptr<ImpactScratch> scratch = std::move(GetThreadImpactScratch());
+	if (!scratch) {
+		scratch = std::make_unique<ImpactScratch>();
+	}
+	if (scratch->states.size() < ordinal_count) {
+		scratch->states.resize(ordinal_count, ImpactScratch::OrdinalState::UNKNOWN);
+		scratch->accumulators.resize(ordinal_count, 0);
+	}
+	return scratch;
+}
+
+void SearchServer::ReleaseImpactScratch(std::unique_ptr<ImpactScratch> scratch) {
+	// a search that touched much of the index is reset faster in one pass
+	if (scratch->touched_ordinals.size() * 8 > scratch->states.size()) {
+		std::fill(scratch->states.begin(), scratch->states.end(), ImpactScratch::OrdinalState::UNKNOWN);
+		std::fill(scratch->accumulators.begin(), scratch->accumulators.end(), 0);
+	}
+	else {
+		for (const DocumentOrdinal ordinal : scratch->touched_ordinals) {
+			scratch->states[ordinal] = ImpactScratch::OrdinalState::UNKNOWN;
+			scratch->accumulators[ordinal] = 0;
+		}
+	}
+	scratch->touched_ordinals.clear();
+	GetThreadImpactScratch() = std::move(scratch);
+}
+
+std::unique_ptr<SearchServer::ImpactScratch>& SearchServer::GetThreadImpactScratch() {
+	thread_local std::unique_ptr<ImpactScratch> scratch;
+	return scratch;
+}
+
+double SearchServer::ComputeWordInverseDocumentFreq(size_t document_freq) const {
+	return std::log(GetDocumentCount() * 1.0 / document_freq);
+}
+
+TermId SearchServer::FindLiveTerm(std::string_view word) const {
+	const TermId term_id = terms_.Find(word);
+	if (term_id == TermDictionary::NO_TERM || document_freqs_[term_id] == 0) {
+		return TermDictionary::NO_TERM;
+	}
+	return term_id;
+}
+
+SegmentedPostings SearchServer::GetPostings(TermId term_id) const {
+	SegmentedPostings postings;
+	for (const auto& segment : segments_) {
+		const CompressedPostingList* segment_postings = segment->FindPostings(term_id);
+		if (segment_postings != nullptr) {
+			postings.sealed.push_back({ segment_postings, segment->GetLastOrdinal() });
+		}
+	}
+	postings.tail = &word_to_document_freqs_[term_id];
+	return postings;
+}
+
+bool SearchServer::ContainsWord(std::string_view word, DocumentOrdinal ordinal) const {
+	const TermId term_id = FindLiveTerm(word);
+	if (term_id == TermDictionary::NO_TERM) {
+		return false;
+	}
+	if (ordinal >= tail_first_ordinal_) {
+		return word_to_document_freqs_[term_id].Contains(ordinal);
+	}
+	const auto segment = std::upper_bound(segments_.begin(), segments_.end(), ordinal,
+		[](DocumentOrdinal ordinal, const std::shared_ptr<const IndexSegment>& segment) {
+			return ordinal < segment->GetLastOrdinal();
+		});
+	const CompressedPostingList* postings = (*segment)->FindPostings(term_id);
+	return postings != nullptr && postings->Contains(ordinal);
+}
+
+std::optional<DocumentOrdinal> SearchServer::FindOrdinal(int document_id) const {
+	const auto it = document_ordinals_.find(document_id);
+	if (it == document_ordinals_.end()) {
+		return std::nullopt;
+	}
+	return it->second;
 }
\ No newline at end of file
@@ -4,26 +4,81 @@
 #include "read_input_functions.h"
 #include "string_processing.h"
 #include "document.h"
-#include "concurrent_map.h"
+#include "posting_list.h"
+#include "compressed_posting_list.h"
+#include "index_segment.h"
+#include "impact_index.h"
+#include "live_ordinals.h"
+#include "perfect_hash.h"
+#include "search_limits.h"
+#include "search_profile.h"
+#include "term_dictionary.h"
+#include "text_arena.h"
+#include "top_documents.h"
 
 #include <iostream>
 #include <algorithm>
 #include <cmath>
 #include <map>
+#include <unordered_map>
 #include <set>
 #include <stdexcept>
 #include <string>
 #include <utility>
 #include <vector>
 #include <numeric>
+#include <optional>
+#include <exception>
+#include <type_traits>
+#include <memory>
 #include <functional>
+#include <iterator>
+#include <limits>
 #include <execution>
 #include <list>
 #include <future>
+#include <chrono>
+#include <thread>
 
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
 
-const double ERROR_COMPARSION = 1e-6;
+enum class RankingMode {
+	// scores every posting of every plus word, then selects the top
+	EXHAUSTIVE,
+	// scores windows of ordinals from the terms whose block bounds can still reach
+	// the current top, and only probes the other terms for documents that may make it
+	DYNAMIC_PRUNING,
+	// score-at-a-time traversal of precomputed quantized tf-idf impacts, from the
+	// highest down, that stops once the quantization error bounds show the top
+	// cannot change; the top is then scored exactly
+	IMPACT_ORDERED,
+};
+
+struct PostingMemoryUsage {
+	size_t posting_count = 0;
+	size_t bytes = 0;
+};
+
+// memory that holds the texts of the documents and the spelling of the words
+struct TextMemoryUsage {
+	size_t document_bytes = 0;
+	size_t word_bytes = 0;
+};
+
+// result of a search under SearchLimits
+struct SearchResult {
+	std::vector<Document> documents;
+	// the search ran out of its limits, documents are the best it had found by then
+	bool is_partial = false;
+};
+
+// one document of a SearchServer::AddDocuments batch
+struct NewDocument {
+	int id;
+	std::string_view text;
+	DocumentStatus status;
+	std::vector<int> ratings;
+};
 
 const size_t BUCKETS_NUM = 8;
 
@@ -33,12 +88,29 @@ public:
 	template <typename StringContainer>
 	explicit SearchServer(const StringContainer& stop_words);
 
+	// stop words hashed at compile time, see MakeStaticWordSet
+	template <size_t N>
+	explicit SearchServer(const StaticWordSet<N>& stop_words);
+
 	explicit SearchServer(const std::string&);
 
 	explicit SearchServer(const std::string_view);
 
 	void AddDocument(int, std::string_view, DocumentStatus, const std::vector<int>&);
 
+	// Adds the documents as AddDocument would one by one: when one of them is invalid,
+	// the documents before it are added and its exception is rethrown. Documents are
+	// tokenized and their postings merged into the index under the execution policy.
+	void AddDocuments(const std::vector<NewDocument>&);
+	template <class ExecutionPolicy>
+	void AddDocuments(ExecutionPolicy&&, const std::vector<NewDocument>&);
+
+	// Replaces the text, status and ratings of a document, keeping its place among the
+	// documents. Only the postings of words whose frequency changed are touched and an
+	// unchanged text is not tokenized again. A document whose postings were already
+	// sealed into a segment is removed and added again at the end when its words change.
+	void UpdateDocument(int, std::string_view, DocumentStatus, const std::vector<int>&);
+
 	template <typename DocumentPredicate>
 	std::vector<Document> FindTopDocuments(std::string_view,
 		DocumentPredicate) const;
@@ -55,13 +127,91 @@ public:
 	template <class ExecutionPolicy>
 	std::vector<Document> FindTopDocuments(ExecutionPolicy&&, std::string_view) const;
 
+	// the same searches with an explicit number of results instead of the server-wide one
+	template <typename DocumentPredicate>
+	std::vector<Document> FindTopDocuments(std::string_view, DocumentPredicate, size_t) const;
+	template <class ExecutionPolicy, typename DocumentPredicate>
+	std::vector<Document> FindTopDocuments(ExecutionPolicy&&, std::string_view, DocumentPredicate, size_t) const;
+
+	std::vector<Document> FindTopDocuments(std::string_view, DocumentStatus, size_t) const;
+	template <class ExecutionPolicy>
+	std::vector<Document> FindTopDocuments(ExecutionPolicy&&, std::string_view, DocumentStatus, size_t) const;
+
+	// Gives up once the limits run out and returns the top of what was scored by then,
+	// flagged as partial: every document matches the query, but better ones may be
+	// missing and the exhaustive mode may not have summed all of their relevance.
+	template <typename DocumentPredicate>
+	SearchResult FindTopDocuments(std::string_view, DocumentPredicate, const SearchLimits&) const;
+	template <typename DocumentPredicate>
+	SearchResult FindTopDocuments(std::string_view, DocumentPredicate, const SearchLimits&, size_t) const;
+	template <typename ExecutionPolicy, typename DocumentPredicate>
+	SearchResult FindTopDocuments(ExecutionPolicy&&, std::string_view, DocumentPredicate, const SearchLimits&) const;
+	template <typename ExecutionPolicy, typename DocumentPredicate>
+	SearchResult FindTopDocuments(ExecutionPolicy&&, std::string_view, DocumentPredicate, const SearchLimits&, size_t) const;
+
+	SearchResult FindTopDocuments(std::string_view, DocumentStatus, const SearchLimits&) const;
+	SearchResult FindTopDocuments(std::string_view, DocumentStatus, const SearchLimits&, size_t) const;
+	template <class ExecutionPolicy>
+	SearchResult FindTopDocuments(ExecutionPolicy&&, std::string_view, DocumentStatus, const SearchLimits&) const;
+	template <class ExecutionPolicy>
+	SearchResult FindTopDocuments(ExecutionPolicy&&, std::string_view, DocumentStatus, const SearchLimits&, size_t) const;
+
+	// Top ACTUAL documents of every query, the same as FindTopDocuments finds one by one.
+	// In the exhaustive mode the queries share their scans: the postings of every word of
+	// the batch are walked once and handed to all the queries that have the word.
+	std::vector<std::vector<Document>> FindTopDocumentsBatch(const std::vector<std::string_view>& queries) const;
+
+	void SetMaxResultDocumentCount(size_t);
+
+	size_t GetMaxResultDocumentCount() const;
+
+	// all modes return the same top documents
+	void SetRankingMode(RankingMode);
+
+	RankingMode GetRankingMode() const;
+
+	// Seals the mutable segment and merges all segments into one compressed segment
+	// without removed documents, waiting for a background merge first if one is running.
+	// The index stays open for changes, new documents go to a new mutable segment.
+	void CompressPostings();
+
+	// true when every posting is in a sealed segment
+	bool IsCompressed() const;
+
+	// Moves the words known so far to a perfect hash, for an index that mostly serves
+	// queries: their lookups become one hash and one compare. New words still go in.
+	void FreezeTerms();
+
+	PostingMemoryUsage GetPostingMemoryUsage() const;
+
+	// Time spent in each phase of the searches so far and the postings and documents they
+	// went through, over every thread. Stays zero unless built with SEARCH_SERVER_PROFILE.
+	SearchProfileStats GetProfile() const;
+
+	void ResetProfile();
+
+	TextMemoryUsage GetTextMemoryUsage() const;
+
+	// writes the index to a file that MappedSearchServer serves without loading it
+	void SaveSnapshot(const std::string& path) const;
+
+	// changes with every change of the documents or of the default number of results,
+	// so results computed at the same generation are still valid
+	uint64_t GetGeneration() const;
+
+	// Query with its plus words sorted and deduplicated, then its minus words; stop words
+	// are dropped. Queries with the same canonical form have exactly the same results.
+	std::string GetCanonicalQuery(std::string_view raw_query) const;
+
 	int GetDocumentCount() const;
 
 	int GetDocumentId(int) const;
 
-	std::vector<int>::const_iterator begin() const;
+	class DocumentIdIterator;
+
+	DocumentIdIterator begin() const;
 
-	std::vector<int>::const_iterator end() const;
+	DocumentIdIterator end() const;
 
 	using MatchDocumentResult = std::tuple<std::vector<std::string_view>, DocumentStatus>;
 
@@ -73,6 +223,8 @@ public:
 	MatchDocumentResult MatchDocument(const std::execution::parallel_policy&,
 		std::string_view raw_query, int document_id) const;
 
+	// Removes a document by marking it as deleted: its postings stay until the segment
+	// holding them is merged, searches skip them. Only the document's own words are touched.
 	void RemoveDocument(int);
 
 	template <class ExecutionPolicy>
@@ -82,9 +234,23 @@ public:
 
 private:
 	struct DocumentData {
+		int id;
 		int rating;
 		DocumentStatus status;
-		std::string doc_text;
+		bool is_removed;
+	};
+
+	struct WordFreq {
+		TermId term_id;
+		double term_freq;
+	};
+
+	// distinct words of a tokenized document with their term frequencies, words
+	// that the dictionary already knows are resolved to their TermIds
+	struct ParsedDocument {
+		std::vector<WordFreq> word_freqs;
+		std::vector<std::pair<std::string_view, double>> new_word_freqs;
+		std::exception_ptr error;
 	};
 
 	struct QueryWord {
@@ -98,32 +264,157 @@ private:
 		std::vector<std::string_view> minus_words;
 	};
 
-	const std::set<std::string, std::less<>> stop_words_;
-	std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
-	std::map<int, DocumentData> documents_;
-	std::vector<int> document_ids_;
+	// result of a background merge, installed by the next change of the index
+	struct SegmentMerge {
+		size_t first_segment;
+		size_t segment_count;
+		std::shared_ptr<const IndexSegment> segment;
+		// filled when the merge also squeezed out the removed documents
+		std::vector<DocumentOrdinal> new_ordinals;
+	};
 
-	std::map<int, std::map<std::string_view, double>> document_to_words_;
+	const FrozenWordSet stop_words_;
+	TermDictionary terms_;
 
-	bool IsStopWord(std::string_view) const;
+	// The postings form an LSM index: immutable sealed segments tile the ordinals
+	// [0, tail_first_ordinal_) in order, the postings of the later ordinals are in the
+	// mutable tail. The tail is sealed once it holds SEGMENT_DOCUMENT_COUNT documents,
+	// and runs of similar sized segments are merged in the background.
+	std::vector<std::shared_ptr<const IndexSegment>> segments_;
+	// the mutable tail, indexed by TermId
+	std::vector<PostingList> word_to_document_freqs_;
+	DocumentOrdinal tail_first_ordinal_ = 0;
+	std::shared_future<SegmentMerge> pending_merge_;
+	// number of live documents with a term, indexed by TermId
+	std::vector<uint32_t> document_freqs_;
+	// changes whenever the postings of a term change, indexed by TermId
+	std::vector<uint64_t> term_versions_;
+	ImpactIndex impact_index_;
+
+	std::unordered_map<int, DocumentOrdinal> document_ordinals_;
+	// indexed by DocumentOrdinal; removed documents stay as holes until the next compaction
+	std::vector<DocumentData> documents_;
+	TextTable document_texts_;
+	std::vector<std::vector<WordFreq>> document_to_words_;
+	size_t removed_document_count_ = 0;
+	// for GetDocumentId while there are holes
+	LiveOrdinals live_ordinals_;
+
+	// smallest slice of ordinals worth a task of its own in parallel searches
+	static constexpr size_t PARALLEL_RANGE_SIZE = 4096;
+	// an exhaustive search sums a list of its postings rather than dense accumulators
+	// while the ordinals outnumber its postings this many times
+	static constexpr size_t SPARSE_SEARCH_RATIO = 8;
+	// slice of ordinals a query batch decodes the postings of at once
+	static constexpr size_t BATCH_RANGE_SIZE = 65536;
+	static constexpr size_t ADD_DOCUMENTS_WINDOW_SIZE = 8192;
+	static constexpr size_t SEGMENT_DOCUMENT_COUNT = 4096;
+	// number of segments of one size tier that are merged together
+	static constexpr size_t SEGMENT_MERGE_FACTOR = 4;
+	static constexpr DocumentOrdinal NO_ORDINAL = std::numeric_limits<DocumentOrdinal>::max();
+	static constexpr size_t IMPACT_RESCORE_COST = 16;
+	// slice of ordinals dynamic pruning bounds and scores at once, a multiple of 64
+	static constexpr size_t PRUNING_WINDOW_SIZE = 4096;
+
+	size_t max_result_document_count_ = MAX_RESULT_DOCUMENT_COUNT;
+	uint64_t generation_ = 0;
+	RankingMode ranking_mode_ = RankingMode::EXHAUSTIVE;
+	mutable SearchProfile profile_;
 
-	static bool IsValidWord(std::string_view);
+	static FrozenWordSet ParseStopWords(std::string_view text);
 
-	std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view) const;
+	static FrozenWordSet FreezeStopWords(const std::set<std::string, std::less<>>& stop_words);
+
+	bool IsStopWord(std::string_view) const;
+
+	// calls function with every word of text that is not a stop word, throws on invalid words
+	template <typename Function>
+	void ForEachWordNoStop(std::string_view text, Function function) const;
 
 	static int ComputeAverageRating(const std::vector<int>&);
 
-	QueryWord ParseQueryWord(std::string_view) const;
+	// words of the document with their frequencies, interned and sorted by TermId
+	std::vector<WordFreq> ComputeWordFreqs(std::string_view document);
+
+	std::vector<WordFreq> InternWordFreqs(const ParsedDocument& parsed_document);
+
+	void AppendDocument(int document_id, std::string_view document, DocumentStatus status, int rating,
+		std::vector<WordFreq> word_freqs);
+
+	ParsedDocument ParseDocument(std::string_view text) const;
+
+	// registers documents until the first invalid one and returns its error
+	std::exception_ptr AppendDocuments(std::vector<NewDocument>::const_iterator first, std::vector<NewDocument>::const_iterator last,
+		const std::vector<ParsedDocument>& parsed_documents);
+
+	// adds the postings of the documents from first_ordinal on, which have none yet
+	template <class ExecutionPolicy>
+	void AddPostings(ExecutionPolicy&& policy, DocumentOrdinal first_ordinal);
+
+	QueryWord ParseQueryWord(std::string_view text, bool is_valid) const;
 
 	Query ParseQuery(std::string_view text, bool skip_sort) const;
 
-	double ComputeWordInverseDocumentFreq(std::string_view word) const;
+	double ComputeWordInverseDocumentFreq(size_t document_freq) const;
+
+	// NO_TERM when no live document has the word
+	TermId FindLiveTerm(std::string_view word) const;
+
+	SegmentedPostings GetPostings(TermId term_id) const;
+
+	bool ContainsWord(std::string_view word, DocumentOrdinal ordinal) const;
+
+	std::optional<DocumentOrdinal> FindOrdinal(int document_id) const;
+
+	void ReleaseDocument(DocumentOrdinal ordinal);
+
+	// renumbers the documents by new_ordinals, NO_ORDINAL drops a document
+	void CompactOrdinals(const std::vector<DocumentOrdinal>& new_ordinals);
+
+	// seals the tail, installs finished merges and starts new ones; called after every change
+	void MaintainSegments();
+
+	void SealTail();
+
+	void InstallMerge(const SegmentMerge& merge);
+
+	void StartMerge(size_t first_segment, size_t segment_count, bool compact, bool is_background);
+
+	// the search of a parsed query in the current ranking mode
+	template <typename ExecutionPolicy, typename DocumentPredicate>
+	std::vector<Document> FindTopDocumentsWithin(ExecutionPolicy&& policy, const Query& query, DocumentPredicate document_predicate,
+		size_t document_count, SearchBudget& budget) const;
 
 	template <typename ExecutionPolicy, typename DocumentPredicate>
-	std::vector<Document> FindAllDocuments(ExecutionPolicy&& policy, const Query& query, DocumentPredicate document_predicate) const;
+	std::vector<Document> FindAllDocuments(ExecutionPolicy&& policy, const Query& query, DocumentPredicate document_predicate,
+		SearchBudget& budget) const;
 
 	template <typename DocumentPredicate>
-	std::vector<Document> FindAllDocuments(const Query&, DocumentPredicate) const;
+	std::vector<Document> FindTopDocumentsPruned(const Query&, DocumentPredicate, size_t, SearchBudget&) const;
+
+	// Per-ordinal state of an impact-ordered search. Every thread keeps one, grown to the
+	// largest index it searched, and a search resets only the ordinals it touched, so it
+	// costs what it walks and not the size of the index.
+	struct ImpactScratch {
+		enum class OrdinalState : uint8_t { UNKNOWN, MATCHING, EXCLUDED };
+
+		std::vector<OrdinalState> states;
+		std::vector<uint32_t> accumulators;
+		// ordinals whose state is not UNKNOWN
+		std::vector<DocumentOrdinal> touched_ordinals;
+	};
+
+	// the scratch of the calling thread with room for ordinal_count ordinals, or a new one
+	// while the thread's own is taken
+	static std::unique_ptr<ImpactScratch> AcquireImpactScratch(size_t ordinal_count);
+
+	// resets what the search touched and gives the scratch back to the thread
+	static void ReleaseImpactScratch(std::unique_ptr<ImpactScratch> scratch);
+
+	static std::unique_ptr<ImpactScratch>& GetThreadImpactScratch();
+
+	template <typename DocumentPredicate>
+	std::vector<Document> FindTopDocumentsByImpact(const Query&, DocumentPredicate, size_t, SearchBudget&) const;
 
 	template <typename ExecutionPolicy, typename ForwardRange, typename Function>
 	void ForEach(const ExecutionPolicy&, ForwardRange&, Function);
@@ -134,30 +425,185 @@ private:
 
 template <typename StringContainer>
 SearchServer::SearchServer(const StringContainer& stop_words)
-	: stop_words_(MakeUniqueNonEmptyStrings(stop_words)) {
+	: stop_words_(FreezeStopWords(MakeUniqueNonEmptyStrings(stop_words))) {
+}
+
+template <size_t N>
+SearchServer::SearchServer(const StaticWordSet<N>& stop_words)
+	: stop_words_(stop_words) {
+}
+
+template <typename Function>
+void SearchServer::ForEachWordNoStop(std::string_view text, Function function) const {
 	using namespace std::string_literals;
 
-	if (!std::all_of(stop_words_.begin(), stop_words_.end(), IsValidWord)) {
-		throw std::invalid_argument("Some of stop words are invalid"s);
+	ForEachWord(text, [this, &function](std::string_view word, bool is_valid) {
+		if (!is_valid) {
+			throw std::invalid_argument("Word "s + word.data() + " is invalid"s);
+		}
+		if (!IsStopWord(word)) {
+			function(word);
+		}
+		});
+}
+
+template <class ExecutionPolicy>
+void SearchServer::AddDocuments(ExecutionPolicy&& policy, const std::vector<NewDocument>& documents) {
+	// Documents go in windows: parsing resolves the words the dictionary knew before the
+	// window, so after the first window most words skip interning, and parsed documents
+	// never hold more than a window of memory.
+	std::vector<ParsedDocument> parsed_documents;
+	for (size_t first = 0; first < documents.size(); first += ADD_DOCUMENTS_WINDOW_SIZE) {
+		const auto window_begin = documents.begin() + first;
+		const auto window_end = documents.begin() + std::min(first + ADD_DOCUMENTS_WINDOW_SIZE, documents.size());
+		parsed_documents.resize(window_end - window_begin);
+		std::transform(policy, window_begin, window_end, parsed_documents.begin(),
+			[this](const NewDocument& document) {
+				return ParseDocument(document.text);
+			});
+
+		const DocumentOrdinal first_ordinal = static_cast<DocumentOrdinal>(documents_.size());
+		const std::exception_ptr error = AppendDocuments(window_begin, window_end, parsed_documents);
+		AddPostings(policy, first_ordinal);
+		MaintainSegments();
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+}
+
+template <class ExecutionPolicy>
+void SearchServer::AddPostings(ExecutionPolicy&& policy, DocumentOrdinal first_ordinal) {
+	const size_t added_count = documents_.size() - first_ordinal;
+	if constexpr (std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>) {
+		for (DocumentOrdinal ordinal = first_ordinal; ordinal < documents_.size(); ++ordinal) {
+			for (const auto [term_id, term_freq] : document_to_words_[ordinal]) {
+				word_to_document_freqs_[term_id].AddTermFreq(ordinal, term_freq);
+			}
+		}
+	}
+	else if (added_count > 0) {
+		// Every chunk of consecutive documents builds a partial inverted index split by
+		// shards of consecutive terms, then every shard appends its postings chunk by chunk,
+		// so each posting list is written by one task and still in ordinal order.
+		struct TermPosting {
+			TermId term_id;
+			DocumentOrdinal ordinal;
+			double term_freq;
+		};
+		const size_t task_count = std::min<size_t>(added_count, std::max(1u, std::thread::hardware_concurrency()) * 4);
+		const size_t term_count = word_to_document_freqs_.size();
+		// partial_indexes[chunk][shard]
+		std::vector<std::vector<std::vector<TermPosting>>> partial_indexes(task_count,
+			std::vector<std::vector<TermPosting>>(task_count));
+		std::vector<size_t> task_indexes(task_count);
+		std::iota(task_indexes.begin(), task_indexes.end(), 0);
+
+		std::for_each(policy, task_indexes.begin(), task_indexes.end(),
+			[&](size_t chunk) {
+				const DocumentOrdinal first = static_cast<DocumentOrdinal>(first_ordinal + added_count * chunk / task_count);
+				const DocumentOrdinal last = static_cast<DocumentOrdinal>(first_ordinal + added_count * (chunk + 1) / task_count);
+				auto& partial_index = partial_indexes[chunk];
+				for (DocumentOrdinal ordinal = first; ordinal < last; ++ordinal) {
+					for (const auto [term_id, term_freq] : document_to_words_[ordinal]) {
+						partial_index[term_id * task_count / term_count].push_back({ term_id, ordinal, term_freq });
+					}
+				}
+			});
+
+		std::for_each(policy, task_indexes.begin(), task_indexes.end(),
+			[&](size_t shard) {
+				for (const auto& partial_index : partial_indexes) {
+					for (const auto [term_id, ordinal, term_freq] : partial_index[shard]) {
+						word_to_document_freqs_[term_id].AddTermFreq(ordinal, term_freq);
+					}
+				}
+			});
 	}
 }
 
 template <typename ExecutionPolicy, typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& police, std::string_view raw_query, DocumentPredicate document_predicate) const {
+	return FindTopDocuments(police, raw_query, document_predicate, max_result_document_count_);
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& police, std::string_view raw_query, DocumentPredicate document_predicate, size_t document_count) const {
 
 	bool skip_sort = std::is_same_v<ExecutionPolicy, std::execution::sequenced_policy>;
 
 	const auto query = ParseQuery(raw_query, skip_sort);
-	auto matched_documents = FindAllDocuments(police, query, document_predicate);
-	std::sort(police, matched_documents.begin(), matched_documents.end(),
-		[](const Document& lhs, const Document& rhs) {
-			return lhs.relevance > rhs.relevance
-				|| (std::abs(lhs.relevance - rhs.relevance) < ERROR_COMPARSION && lhs.rating > rhs.rating);
-		});
-	if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-		matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+	SearchBudget budget;
+	return FindTopDocumentsWithin(police, query, document_predicate, document_count, budget);
+}
+
+template <typename DocumentPredicate>
+SearchResult SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, const SearchLimits& limits) const {
+	return FindTopDocuments(std::execution::seq, raw_query, document_predicate, limits, max_result_document_count_);
+}
+
+template <typename DocumentPredicate>
+SearchResult SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, const SearchLimits& limits,
+	size_t document_count) const {
+	return FindTopDocuments(std::execution::seq, raw_query, document_predicate, limits, document_count);
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+SearchResult SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentPredicate document_predicate,
+	const SearchLimits& limits) const {
+	return FindTopDocuments(policy, raw_query, document_predicate, limits, max_result_document_count_);
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+SearchResult SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentPredicate document_predicate,
+	const SearchLimits& limits, size_t document_count) const {
+	SearchBudget budget(limits);
+	SearchResult result;
+	result.documents = FindTopDocumentsWithin(policy, ParseQuery(raw_query, false), document_predicate, document_count, budget);
+	result.is_partial = budget.IsExhausted();
+	return result;
+}
+
+template <class ExecutionPolicy>
+SearchResult SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentStatus status,
+	const SearchLimits& limits) const {
+	return FindTopDocuments(policy, raw_query, status, limits, max_result_document_count_);
+}
+
+template <class ExecutionPolicy>
+SearchResult SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentStatus status,
+	const SearchLimits& limits, size_t document_count) const {
+	return FindTopDocuments(policy,
+		raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
+			return document_status == status;
+		}, limits, document_count);
+}
+
+template <typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsWithin(ExecutionPolicy&& policy, const Query& query, DocumentPredicate document_predicate,
+	size_t document_count, SearchBudget& budget) const {
+	if (ranking_mode_ == RankingMode::DYNAMIC_PRUNING) {
+		return FindTopDocumentsPruned(query, document_predicate, document_count, budget);
 	}
-	return matched_documents;
+	if (ranking_mode_ == RankingMode::IMPACT_ORDERED) {
+		return FindTopDocumentsByImpact(query, document_predicate, document_count, budget);
+	}
+	const auto matched_documents = FindAllDocuments(policy, query, document_predicate, budget);
+	PROFILE_PHASE(profile_, SearchPhase::SORT);
+	return SelectTopDocuments(policy, matched_documents, document_count);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, size_t document_count) const {
+	return FindTopDocuments(std::execution::seq, raw_query, document_predicate, document_count);
+}
+
+template <class ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentStatus status, size_t document_count) const {
+	return FindTopDocuments(policy,
+		raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
+			return document_status == status;
+		}, document_count);
 }
 
 template <typename DocumentPredicate>
@@ -179,81 +625,613 @@ std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, s
 }
 
 template <typename ExecutionPolicy, typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(ExecutionPolicy&& policy, const Query& query, DocumentPredicate document_predicate) const {
-
-	std::map<int, double> document_to_relevance;
-	ConcurrentMap<int, double> concurrent_map(16);
-	std::for_each(policy,
-		query.plus_words.begin(),
-		query.plus_words.end(),
-		[this, &concurrent_map, &document_predicate](std::string_view word) {
-			if (!word_to_document_freqs_.count(word) == 0) {
-				const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-				for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-					const auto& document_data = documents_.at(document_id);
-					if (document_predicate(document_id, document_data.status, document_data.rating)) {
-						concurrent_map[document_id].ref_to_value += term_freq * inverse_document_freq;
+std::vector<Document> SearchServer::FindAllDocuments(ExecutionPolicy&& policy, const Query& query, DocumentPredicate document_predicate,
+	SearchBudget& budget) const {
+	struct WordPostings {
+		SegmentedPostings postings;
+		double inverse_document_freq;
+	};
+
+	std::vector<WordPostings> plus_postings;
+	size_t plus_posting_count = 0;
+	for (std::string_view word : query.plus_words) {
+		const TermId term_id = FindLiveTerm(word);
+		if (term_id != TermDictionary::NO_TERM) {
+			plus_postings.push_back({ GetPostings(term_id), ComputeWordInverseDocumentFreq(document_freqs_[term_id]) });
+			plus_posting_count += document_freqs_[term_id];
+		}
+	}
+	std::vector<SegmentedPostings> minus_postings;
+	for (std::string_view word : query.minus_words) {
+		const TermId term_id = FindLiveTerm(word);
+		if (term_id != TermDictionary::NO_TERM) {
+			minus_postings.push_back(GetPostings(term_id));
+		}
+	}
+
+	// A query whose postings cover few of the ordinals is summed from the list of its
+	// postings, so it costs its postings and not the size of the index
+	if (plus_posting_count * SPARSE_SEARCH_RATIO < documents_.size()) {
+		struct Contribution {
+			DocumentOrdinal ordinal;
+			double relevance;
+		};
+		std::vector<Contribution> contributions;
+		contributions.reserve(plus_posting_count);
+		size_t posting_count = 0;
+		{
+			PROFILE_PHASE(profile_, SearchPhase::POSTINGS);
+			for (const auto& [postings, inverse_document_freq] : plus_postings) {
+				for (SegmentedPostingCursor cursor(postings); !cursor.IsEnd(); cursor.Next()) {
+					if (++posting_count % SearchBudget::CHECK_INTERVAL == 0 && budget.Check()) {
+						break;
 					}
+					contributions.push_back({ cursor.GetOrdinal(), cursor.GetTermFreq() * inverse_document_freq });
+				}
+				if (budget.IsExhausted()) {
+					break;
 				}
 			}
+			// stable, so the contributions to a document stay in query order
+			std::stable_sort(contributions.begin(), contributions.end(), [](const Contribution& lhs, const Contribution& rhs) {
+				return lhs.ordinal < rhs.ordinal;
+			});
 		}
-	);
+		PROFILE_COUNT(profile_, Postings, posting_count);
 
-	for_each(policy,
-		query.minus_words.begin(),
-		query.minus_words.end(),
-		[this, &document_predicate, &concurrent_map](std::string_view word) {
-			if (!word_to_document_freqs_.count(word) == 0) {
-				for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-					concurrent_map.Erase(document_id);
-				}
+		PROFILE_PHASE(profile_, SearchPhase::MATERIALIZE);
+		std::vector<SegmentedPostingCursor> minus_cursors(minus_postings.begin(), minus_postings.end());
+		std::vector<Document> matched_documents;
+		for (auto it = contributions.begin(); it != contributions.end();) {
+			const DocumentOrdinal ordinal = it->ordinal;
+			double relevance = 0.0;
+			for (; it != contributions.end() && it->ordinal == ordinal; ++it) {
+				relevance += it->relevance;
+			}
+			const auto& document_data = documents_[ordinal];
+			if (document_data.is_removed || !document_predicate(document_data.id, document_data.status, document_data.rating)) {
+				continue;
+			}
+			// ordinals ascend, so every minus cursor only moves forward
+			const bool is_excluded = std::any_of(minus_cursors.begin(), minus_cursors.end(), [ordinal](SegmentedPostingCursor& cursor) {
+				cursor.SkipTo(ordinal);
+				return cursor.GetOrdinal() == ordinal;
+			});
+			if (!is_excluded) {
+				matched_documents.push_back({ document_data.id, relevance, document_data.rating });
 			}
 		}
-	);
+		PROFILE_COUNT(profile_, Documents, matched_documents.size());
+		return matched_documents;
+	}
 
-	document_to_relevance = concurrent_map.BuildOrdinaryMap();
+	// The ordinal space is cut into ranges, each range owns its dense accumulators
+	// and walks the slice of every posting list that falls into it, so ranges never
+	// share memory and need no locks. Relevance of a document is still summed in
+	// query order, the same for every policy. The minus words go first, so a range that
+	// runs out of budget still never matches a document it should have excluded.
+	size_t range_count = 1;
+	if constexpr (!std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>) {
+		range_count = std::clamp<size_t>(documents_.size() / PARALLEL_RANGE_SIZE,
+			1, std::max(1u, std::thread::hardware_concurrency()) * 4);
+	}
+	const size_t range_size = (documents_.size() + range_count - 1) / range_count;
+	std::vector<std::vector<Document>> range_documents(range_count);
+	std::vector<size_t> range_indexes(range_count);
+	std::iota(range_indexes.begin(), range_indexes.end(), 0);
 
-	std::vector<Document> matched_documents;
-	matched_documents.reserve(document_to_relevance.size());
-
-	for_each(std::execution::seq,
-		document_to_relevance.begin(), document_to_relevance.end(),
-		[this, &matched_documents](const auto& document) {
-			matched_documents.push_back({
-				document.first,
-				document.second,
-				documents_.at(document.first).rating
-				});
+	std::for_each(policy, range_indexes.begin(), range_indexes.end(),
+		[&](size_t range_index) {
+			const DocumentOrdinal first = static_cast<DocumentOrdinal>(std::min(range_index * range_size, documents_.size()));
+			const DocumentOrdinal last = static_cast<DocumentOrdinal>(std::min(first + range_size, documents_.size()));
+			std::vector<double> document_to_relevance(last - first, 0.0);
+			std::vector<bool> is_matched(last - first, false);
+			std::vector<bool> is_excluded(last - first, false);
+			size_t posting_count = 0;
+
+			{
+				PROFILE_PHASE(profile_, SearchPhase::MINUS_WORDS);
+				for (const SegmentedPostings& postings : minus_postings) {
+					SegmentedPostingCursor cursor(postings);
+					for (cursor.SkipTo(first); cursor.GetOrdinal() < last; cursor.Next()) {
+						if (++posting_count % SearchBudget::CHECK_INTERVAL == 0 && budget.Check()) {
+							return;
+						}
+						is_excluded[cursor.GetOrdinal() - first] = true;
+					}
+				}
+			}
+			{
+				PROFILE_PHASE(profile_, SearchPhase::POSTINGS);
+				for (const auto& [postings, inverse_document_freq] : plus_postings) {
+					if (budget.IsExhausted()) {
+						break;
+					}
+					SegmentedPostingCursor cursor(postings);
+					for (cursor.SkipTo(first); cursor.GetOrdinal() < last; cursor.Next()) {
+						if (++posting_count % SearchBudget::CHECK_INTERVAL == 0 && budget.Check()) {
+							break;
+						}
+						const DocumentOrdinal ordinal = cursor.GetOrdinal();
+						const auto& document_data = documents_[ordinal];
+						if (!document_data.is_removed && document_predicate(document_data.id, document_data.status, document_data.rating)) {
+							document_to_relevance[ordinal - first] += cursor.GetTermFreq() * inverse_document_freq;
+							is_matched[ordinal - first] = true;
+						}
+					}
+				}
+			}
+			PROFILE_COUNT(profile_, Postings, posting_count);
+
+			PROFILE_PHASE(profile_, SearchPhase::MATERIALIZE);
+			auto& matched_documents = range_documents[range_index];
+			for (DocumentOrdinal ordinal = first; ordinal < last; ++ordinal) {
+				if (is_matched[ordinal - first] && !is_excluded[ordinal - first]) {
+					matched_documents.push_back({
+						documents_[ordinal].id,
+						document_to_relevance[ordinal - first],
+						documents_[ordinal].rating
+						});
+				}
+			}
+			PROFILE_COUNT(profile_, Documents, matched_documents.size());
 		}
 	);
+
+	if (range_count == 1) {
+		return std::move(range_documents.front());
+	}
+	PROFILE_PHASE(profile_, SearchPhase::MATERIALIZE);
+	std::vector<Document> matched_documents;
+	size_t matched_count = 0;
+	for (const auto& documents : range_documents) {
+		matched_count += documents.size();
+	}
+	matched_documents.reserve(matched_count);
+	for (const auto& documents : range_documents) {
+		matched_documents.insert(matched_documents.end(), documents.begin(), documents.end());
+	}
 	return matched_documents;
 }
 
+
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const SearchServer::Query& query,
-	DocumentPredicate document_predicate) const {
-	return SearchServer::FindAllDocuments(std::execution::seq, query, document_predicate);
+std::vector<Document> SearchServer::FindTopDocumentsPruned(const Query& query, DocumentPredicate document_predicate,
+	size_t document_count, SearchBudget& budget) const {
+	using Cursor = SegmentedPostingCursor;
+
+	struct TermCursor {
+		SegmentedPostings postings;
+		Cursor cursor;
+		double inverse_document_freq;
+		// bound of the term in the current window
+		double window_bound = 0.0;
+		bool is_essential = false;
+	};
+	TopDocuments top_documents(document_count);
+	if (document_count == 0) {
+		return top_documents.Extract();
+	}
+
+	std::vector<TermCursor> term_cursors;
+	term_cursors.reserve(query.plus_words.size());
+	for (std::string_view word : query.plus_words) {
+		const TermId term_id = FindLiveTerm(word);
+		if (term_id != TermDictionary::NO_TERM) {
+			SegmentedPostings postings = GetPostings(term_id);
+			Cursor cursor(postings);
+			term_cursors.push_back({ std::move(postings), std::move(cursor), ComputeWordInverseDocumentFreq(document_freqs_[term_id]) });
+		}
+	}
+	std::vector<Cursor> minus_cursors;
+	for (std::string_view word : query.minus_words) {
+		const TermId term_id = FindLiveTerm(word);
+		if (term_id != TermDictionary::NO_TERM) {
+			minus_cursors.emplace_back(GetPostings(term_id));
+		}
+	}
+	const auto is_excluded = [&minus_cursors](DocumentOrdinal ordinal) {
+		for (Cursor& cursor : minus_cursors) {
+			cursor.SkipTo(ordinal);
+			if (cursor.GetOrdinal() == ordinal) {
+				return true;
+			}
+		}
+		return false;
+	};
+	// a document can only be skipped when its bound is below the worst kept relevance
+	// by more than ERROR_COMPARSION (closer ones may share its bucket and win on rating),
+	// with another ERROR_COMPARSION of margin for the rounding of the summed bounds
+	const auto get_threshold = [&top_documents]() {
+		return top_documents.IsFull()
+			? top_documents.GetWorst().relevance - 2 * ERROR_COMPARSION
+			: -std::numeric_limits<double>::infinity();
+	};
+
+	// Block-max MaxScore over windows of PRUNING_WINDOW_SIZE ordinals. In every window the
+	// terms get the bound of their blocks that overlap it; the terms with the smallest bounds
+	// whose bounds sum up below the threshold are non-essential there. A window without
+	// essential terms is skipped as a whole. The essential terms are scored term at a time
+	// into dense accumulators in query order, like FindAllDocuments does, and only the
+	// documents whose score and remaining bounds reach the threshold probe the others.
+	std::vector<double> window_scores(PRUNING_WINDOW_SIZE, 0.0);
+	std::vector<uint64_t> window_matches(PRUNING_WINDOW_SIZE / 64, 0);
+	// second cursors of every term, for the documents a non-essential term adds to
+	std::vector<Cursor> rescore_cursors;
+	std::vector<TermCursor*> by_bound;
+	for (TermCursor& term_cursor : term_cursors) {
+		by_bound.push_back(&term_cursor);
+	}
+	std::vector<double> bound_prefix(by_bound.size());
+
+	DocumentOrdinal first = Cursor::END;
+	for (const TermCursor& term_cursor : term_cursors) {
+		first = std::min(first, term_cursor.cursor.GetOrdinal());
+	}
+	PROFILE_PHASE(profile_, SearchPhase::POSTINGS);
+	while (first != Cursor::END && !budget.Check()) {
+		const DocumentOrdinal last = first + std::min<DocumentOrdinal>(PRUNING_WINDOW_SIZE - 1, Cursor::END - 1 - first);
+		double threshold = get_threshold();
+		for (TermCursor& term_cursor : term_cursors) {
+			term_cursor.window_bound = term_cursor.cursor.GetMaxTermFreqIn(first, last) * term_cursor.inverse_document_freq;
+			term_cursor.is_essential = false;
+		}
+		std::sort(by_bound.begin(), by_bound.end(), [](const TermCursor* lhs, const TermCursor* rhs) {
+			return lhs->window_bound < rhs->window_bound;
+		});
+		double bound_sum = 0.0;
+		size_t first_essential = by_bound.size();
+		for (size_t i = 0; i < by_bound.size(); ++i) {
+			bound_sum += by_bound[i]->window_bound;
+			bound_prefix[i] = bound_sum;
+			if (first_essential == by_bound.size() && bound_sum >= threshold) {
+				first_essential = i;
+			}
+		}
+		for (size_t i = first_essential; i < by_bound.size(); ++i) {
+			by_bound[i]->is_essential = true;
+		}
+
+		size_t posting_count = 0;
+		for (TermCursor& term_cursor : term_cursors) {
+			if (!term_cursor.is_essential) {
+				continue;
+			}
+			Cursor& cursor = term_cursor.cursor;
+			for (cursor.SkipTo(first); cursor.GetOrdinal() <= last; cursor.Next()) {
+				const uint32_t offset = cursor.GetOrdinal() - first;
+				const double contribution = cursor.GetTermFreq() * term_cursor.inverse_document_freq;
+				window_scores[offset] += contribution;
+				window_matches[offset / 64] |= uint64_t{ 1 } << (offset % 64);
+				++posting_count;
+			}
+		}
+		PROFILE_COUNT(profile_, Postings, posting_count);
+
+		for (size_t word = 0; word < window_matches.size(); ++word) {
+			uint32_t offset = static_cast<uint32_t>(word * 64);
+			for (uint64_t bits = window_matches[word]; bits != 0; bits >>= 1, ++offset) {
+				if ((bits & 1) == 0) {
+					continue;
+				}
+				const DocumentOrdinal ordinal = first + offset;
+				const double essential_score = window_scores[offset];
+				window_scores[offset] = 0.0;
+				double score = essential_score;
+				if (score + (first_essential > 0 ? bound_prefix[first_essential - 1] : 0.0) < threshold) {
+					continue;
+				}
+				bool is_pruned = false;
+				bool has_non_essential = false;
+				for (size_t i = first_essential; i-- > 0;) {
+					// bound_prefix[i] covers the non-essential terms not probed yet
+					if (score + bound_prefix[i] < threshold) {
+						is_pruned = true;
+						break;
+					}
+					Cursor& cursor = by_bound[i]->cursor;
+					cursor.SkipTo(ordinal);
+					if (cursor.GetOrdinal() == ordinal) {
+						score += cursor.GetTermFreq() * by_bound[i]->inverse_document_freq;
+						has_non_essential = true;
+					}
+				}
+				if (is_pruned || score < threshold) {
+					continue;
+				}
+				const auto& document_data = documents_[ordinal];
+				if (document_data.is_removed || !document_predicate(document_data.id, document_data.status, document_data.rating)
+					|| is_excluded(ordinal)) {
+					continue;
+				}
+				// summed in query order, exactly as FindAllDocuments does: the window score already
+				// is, unless a non-essential term adds to the document somewhere in between
+				double relevance = essential_score;
+				if (has_non_essential) {
+					if (rescore_cursors.empty()) {
+						for (const TermCursor& term_cursor : term_cursors) {
+							rescore_cursors.emplace_back(term_cursor.postings);
+						}
+					}
+					relevance = 0.0;
+					for (size_t i = 0; i < term_cursors.size(); ++i) {
+						rescore_cursors[i].SkipTo(ordinal);
+						if (rescore_cursors[i].GetOrdinal() == ordinal) {
+							relevance += rescore_cursors[i].GetTermFreq() * term_cursors[i].inverse_document_freq;
+						}
+					}
+				}
+				PROFILE_COUNT(profile_, Documents, 1);
+				if (top_documents.Push({ document_data.id, relevance, document_data.rating })) {
+					threshold = get_threshold();
+				}
+			}
+			window_matches[word] = 0;
+		}
+
+		if (last == Cursor::END - 1) {
+			break;
+		}
+		first = Cursor::END;
+		for (TermCursor& term_cursor : term_cursors) {
+			term_cursor.cursor.SkipTo(last + 1);
+			first = std::min(first, term_cursor.cursor.GetOrdinal());
+		}
+	}
+	PROFILE_PHASE(profile_, SearchPhase::SORT);
+	return top_documents.Extract();
 }
 
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsByImpact(const Query& query, DocumentPredicate document_predicate,
+	size_t document_count, SearchBudget& budget) const {
+	struct TermImpacts {
+		TermId term_id;
+		double inverse_document_freq;
+		std::shared_ptr<const ImpactList> impacts;
+		size_t next_segment;
+	};
+	struct SegmentRef {
+		uint16_t impact;
+		size_t term_index;
+		size_t segment_index;
+	};
+	using OrdinalState = ImpactScratch::OrdinalState;
+
+	TopDocuments top_documents(document_count);
+	if (document_count == 0) {
+		return top_documents.Extract();
+	}
+
+	std::vector<TermImpacts> terms;
+	std::vector<SegmentRef> segments;
+	// bound of the difference between the impact sum of a document and its scaled relevance
+	double max_error = 0.0;
+	// bound of what the segments not walked yet add to a document
+	uint64_t remaining_bound = 0;
+	size_t remaining_posting_count = 0;
+	for (std::string_view word : query.plus_words) {
+		const TermId term_id = FindLiveTerm(word);
+		if (term_id == TermDictionary::NO_TERM) {
+			continue;
+		}
+		const double inverse_document_freq = ComputeWordInverseDocumentFreq(document_freqs_[term_id]);
+		auto impacts = impact_index_.GetList(term_id, GetPostings(term_id), inverse_document_freq, term_versions_[term_id]);
+		const auto& term_segments = impacts->GetSegments();
+		for (size_t i = 0; i < term_segments.size(); ++i) {
+			segments.push_back({ term_segments[i].impact, terms.size(), i });
+		}
+		if (!term_segments.empty()) {
+			remaining_bound += term_segments.front().impact;
+		}
+		max_error += impacts->GetMaxError(inverse_document_freq);
+		remaining_posting_count += impacts->GetOrdinals().size();
+		terms.push_back({ term_id, inverse_document_freq, std::move(impacts), 0 });
+	}
+	// segments of one term have distinct impacts, so a stable sort keeps their order
+	std::stable_sort(segments.begin(), segments.end(), [](const SegmentRef& lhs, const SegmentRef& rhs) {
+		return lhs.impact > rhs.impact;
+	});
+
+	struct ScratchRelease {
+		std::unique_ptr<ImpactScratch> scratch;
+
+		~ScratchRelease() {
+			ReleaseImpactScratch(std::move(scratch));
+		}
+	};
+	const ScratchRelease scratch_release{ AcquireImpactScratch(documents_.size()) };
+	ImpactScratch& scratch = *scratch_release.scratch;
+	OrdinalState* const states = scratch.states.data();
+	uint32_t* const accumulators = scratch.accumulators.data();
+	std::vector<DocumentOrdinal>& touched_ordinals = scratch.touched_ordinals;
+	size_t walked_count = 0;
+	{
+		PROFILE_PHASE(profile_, SearchPhase::MINUS_WORDS);
+		for (std::string_view word : query.minus_words) {
+			const TermId term_id = FindLiveTerm(word);
+			if (term_id != TermDictionary::NO_TERM) {
+				for (SegmentedPostingCursor cursor(GetPostings(term_id)); !cursor.IsEnd(); cursor.Next()) {
+					// without all the minus words no document is known to match
+					if (++walked_count % SearchBudget::CHECK_INTERVAL == 0 && budget.Check()) {
+						return top_documents.Extract();
+					}
+					if (states[cursor.GetOrdinal()] == OrdinalState::UNKNOWN) {
+						touched_ordinals.push_back(cursor.GetOrdinal());
+					}
+					states[cursor.GetOrdinal()] = OrdinalState::EXCLUDED;
+				}
+			}
+		}
+	}
+
+	std::vector<DocumentOrdinal> matching_ordinals;
+	std::vector<uint32_t> scores;
+	// The candidates are scored exactly in the end, so a document can only be dropped
+	// when even its best exact score stays below the worst exact score of the top by
+	// impacts, by a unit more than ERROR_COMPARSION would need
+	const double margin = 2 * max_error + 1.0;
+	// impact sum of the document-th best document, 0 while there are fewer
+	const auto find_top_score = [&]() {
+		scores.clear();
+		for (const DocumentOrdinal ordinal : matching_ordinals) {
+			scores.push_back(accumulators[ordinal]);
+		}
+		if (scores.size() < document_count) {
+			return uint32_t{ 0 };
+		}
+		std::nth_element(scores.begin(), scores.begin() + (document_count - 1), scores.end(), std::greater<>());
+		return scores[document_count - 1];
+	};
+	const auto is_candidate = [&](uint32_t score, uint32_t top_score) {
+		return score + remaining_bound + margin >= top_score;
+	};
+
+	size_t postings_since_check = 0;
+	{
+		PROFILE_PHASE(profile_, SearchPhase::POSTINGS);
+		for (const auto [impact, term_index, segment_index] : segments) {
+			TermImpacts& term = terms[term_index];
+			const auto& term_segments = term.impacts->GetSegments();
+			const auto& ordinals = term.impacts->GetOrdinals();
+			for (uint32_t i = term_segments[segment_index].first; i < term_segments[segment_index].last; ++i) {
+				if (++walked_count % SearchBudget::CHECK_INTERVAL == 0 && budget.Check()) {
+					break;
+				}
+				const DocumentOrdinal ordinal = ordinals[i];
+				if (states[ordinal] == OrdinalState::UNKNOWN) {
+					const auto& document_data = documents_[ordinal];
+					const bool is_matching = !document_data.is_removed
+						&& document_predicate(document_data.id, document_data.status, document_data.rating);
+					states[ordinal] = is_matching ? OrdinalState::MATCHING : OrdinalState::EXCLUDED;
+					touched_ordinals.push_back(ordinal);
+					if (is_matching) {
+						matching_ordinals.push_back(ordinal);
+					}
+				}
+				if (states[ordinal] == OrdinalState::MATCHING) {
+					accumulators[ordinal] += impact;
+				}
+			}
+			if (budget.IsExhausted()) {
+				break;
+			}
+			remaining_bound -= impact;
+			term.next_segment = segment_index + 1;
+			if (term.next_segment < term_segments.size()) {
+				remaining_bound += term_segments[term.next_segment].impact;
+			}
+
+			// A check costs a pass over the matched documents, it runs once as many postings were
+			// added. The walk stops when no document unseen so far can reach the top and scoring
+			// the candidates exactly is cheaper than walking the remaining postings: a lookup of
+			// a word in a document costs about as much as IMPACT_RESCORE_COST postings.
+			const size_t posting_count = term_segments[segment_index].last - term_segments[segment_index].first;
+			remaining_posting_count -= posting_count;
+			postings_since_check += posting_count;
+			if (postings_since_check >= matching_ordinals.size() && matching_ordinals.size() >= document_count) {
+				postings_since_check = 0;
+				const uint32_t top_score = find_top_score();
+				if (!is_candidate(0, top_score)) {
+					const size_t candidate_count = std::count_if(scores.begin(), scores.end(), [&](uint32_t score) {
+						return is_candidate(score, top_score);
+					});
+					if (candidate_count * terms.size() * IMPACT_RESCORE_COST <= remaining_posting_count) {
+						break;
+					}
+				}
+			}
+		}
+	}
+	PROFILE_COUNT(profile_, Postings, walked_count);
+
+	// the top by impacts and every document that could still belong to the exact top;
+	// a walk cut short by the budget only keeps the best by the impacts seen
+	if (budget.IsExhausted()) {
+		remaining_bound = 0;
+	}
+	// the candidates are scored exactly here
+	{
+		PROFILE_PHASE(profile_, SearchPhase::MATERIALIZE);
+		const uint32_t top_score = find_top_score();
+		for (const DocumentOrdinal ordinal : matching_ordinals) {
+			if (!is_candidate(accumulators[ordinal], top_score)) {
+				continue;
+			}
+			// summed in query order, exactly as FindAllDocuments does
+			const auto& word_freqs = document_to_words_[ordinal];
+			double relevance = 0.0;
+			for (const TermImpacts& term : terms) {
+				const auto it = std::lower_bound(word_freqs.begin(), word_freqs.end(), term.term_id,
+					[](const WordFreq& word_freq, TermId term_id) {
+						return word_freq.term_id < term_id;
+					});
+				if (it != word_freqs.end() && it->term_id == term.term_id) {
+					relevance += it->term_freq * term.inverse_document_freq;
+				}
+			}
+			PROFILE_COUNT(profile_, Documents, 1);
+			top_documents.Push({ documents_[ordinal].id, relevance, documents_[ordinal].rating });
+		}
+	}
+	PROFILE_PHASE(profile_, SearchPhase::SORT);
+	return top_documents.Extract();
+}
 
 template <class ExecutionPolicy>
-void SearchServer::RemoveDocument(ExecutionPolicy&& policy, int document_id) {
-	const auto& word_freqs = document_to_words_.at(document_id);
-	std::mutex value_mutex;
-	std::vector<const std::string*> words(word_freqs.size());
-	std::transform(
-		policy,
-		word_freqs.begin(), word_freqs.end(),
-		words.begin(),
-		[](const auto& word) {
-			return &word.first;
-		});
-	std::for_each(policy, words.begin(), words.end(),
-		[this, document_id, value_mutex](const std::string* word) {
-			std::lock_guard guard(value_mutex);
-			word_to_document_freqs_.at(*word).erase(document_id);
-		});
+void SearchServer::RemoveDocument(ExecutionPolicy&&, int document_id) {
+	// a removal only marks the document, there is nothing left to run in parallel
+	RemoveDocument(document_id);
+}
+
+class SearchServer::DocumentIdIterator {
+public:
+	using iterator_category = std::forward_iterator_tag;
+	using value_type = int;
+	using difference_type = std::ptrdiff_t;
+	using pointer = const int*;
+	using reference = const int&;
+
+	DocumentIdIterator(const DocumentData* current, const DocumentData* last)
+		: current_(current), last_(last) {
+		SkipRemoved();
+	}
+
+	reference operator*() const {
+		return current_->id;
+	}
+
+	pointer operator->() const {
+		return &current_->id;
+	}
+
+	DocumentIdIterator& operator++() {
+		++current_;
+		SkipRemoved();
+		return *this;
+	}
+
+	DocumentIdIterator operator++(int) {
+		DocumentIdIterator prev = *this;
+		++*this;
+		return prev;
+	}
 
-	documents_.erase(document_id);
-	document_to_words_.erase(document_id);
-}
\ No newline at end of file
+	bool operator==(const DocumentIdIterator& other) const {
+		return current_ == other.current_;
+	}
+
+	bool operator!=(const DocumentIdIterator& other) const {
+		return current_ != other.current_;
+	}
+
+private:
+	const DocumentData* current_;
+	const DocumentData* last_;
+
+	void SkipRemoved() {
+		while (current_ != last_ && current_->is_removed) {
+			++current_;
+		}
+	}
+};
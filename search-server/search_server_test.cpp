@@ -0,0 +1,695 @@
+// Randomized differential tests: every search path of the index is checked against
+// a naive reference that scores each live document from its own word frequencies.
+// Usage: search_server_test [SEED]
+
+#include "concurrent_search_server.h"
+#include "index_snapshot.h"
+#include "process_queries.h"
+#include "query_result_cache.h"
+#include "search_server.h"
+#include "top_documents.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <execution>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace std::literals;
+
+namespace {
+
+const uint32_t DEFAULT_SEED = 20240917;
+// more than SearchServer::SEGMENT_DOCUMENT_COUNT, so the index has sealed segments and a tail
+const int DOCUMENT_COUNT = 9000;
+const int QUERY_COUNT = 40;
+const size_t MAX_REPORTED_FAILURES = 20;
+
+size_t check_count = 0;
+size_t failure_count = 0;
+
+void Check(bool condition, const std::string& what) {
+	++check_count;
+	if (!condition) {
+		if (failure_count < MAX_REPORTED_FAILURES) {
+			std::cerr << "FAILED: "s << what << std::endl;
+		}
+		++failure_count;
+	}
+}
+
+std::string Describe(const std::vector<Document>& documents) {
+	std::ostringstream output;
+	output.precision(17);
+	output << '[';
+	for (const Document& document : documents) {
+		output << " {"s << document.id << ", "s << document.relevance << ", "s << document.rating << '}';
+	}
+	output << " ]"s;
+	return output.str();
+}
+
+// relevances are compared bit for bit: every path sums the same products in the same order
+bool AreSame(const std::vector<Document>& lhs, const std::vector<Document>& rhs) {
+	return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), [](const Document& l, const Document& r) {
+		return l.id == r.id && l.rating == r.rating && std::memcmp(&l.relevance, &r.relevance, sizeof(double)) == 0;
+		});
+}
+
+void CheckSame(const std::vector<Document>& actual, const std::vector<Document>& expected, const std::string& what) {
+	const bool is_same = AreSame(actual, expected);
+	Check(is_same, is_same ? what : what + "\n  actual:   "s + Describe(actual) + "\n  expected: "s + Describe(expected));
+}
+
+std::vector<std::string_view> SplitWords(std::string_view text) {
+	std::vector<std::string_view> words;
+	while (!text.empty()) {
+		const size_t space = text.find(' ');
+		words.push_back(text.substr(0, space));
+		text.remove_prefix(space == std::string_view::npos ? text.size() : space + 1);
+	}
+	return words;
+}
+
+// The index as the definition of the ranking states it: tf is the share of the
+// non-stop words of a document, idf the log of the live documents over the live
+// documents with the word, and a document scores the sum over the distinct plus
+// words of the query, in sorted order, of tf * idf.
+class ReferenceIndex {
+public:
+	explicit ReferenceIndex(std::set<std::string, std::less<>> stop_words)
+		: stop_words_(std::move(stop_words)) {
+	}
+
+	void AddDocument(int id, std::string_view text, DocumentStatus status, const std::vector<int>& ratings) {
+		RemoveDocument(id);
+		Entry& entry = documents_[id];
+		entry.status = status;
+		entry.rating = 0;
+		for (const int rating : ratings) {
+			entry.rating += rating;
+		}
+		entry.rating /= static_cast<int>(ratings.size());
+
+		std::vector<std::string_view> words;
+		for (std::string_view word : SplitWords(text)) {
+			if (stop_words_.count(word) == 0) {
+				words.push_back(word);
+			}
+		}
+		const double inv_word_count = 1.0 / words.size();
+		for (std::string_view word : words) {
+			entry.term_freqs[std::string(word)] += inv_word_count;
+			word_to_documents_[std::string(word)].insert(id);
+		}
+	}
+
+	void RemoveDocument(int id) {
+		const auto it = documents_.find(id);
+		if (it == documents_.end()) {
+			return;
+		}
+		for (const auto& [word, term_freq] : it->second.term_freqs) {
+			word_to_documents_[word].erase(id);
+		}
+		documents_.erase(it);
+	}
+
+	std::vector<int> GetDocumentIds() const {
+		std::vector<int> ids;
+		for (const auto& [id, entry] : documents_) {
+			ids.push_back(id);
+		}
+		return ids;
+	}
+
+	template <typename DocumentPredicate>
+	std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, size_t count) const {
+		std::vector<std::string> plus_words;
+		std::vector<std::string> minus_words;
+		for (std::string_view word : SplitWords(raw_query)) {
+			const bool is_minus = word[0] == '-';
+			if (is_minus) {
+				word.remove_prefix(1);
+			}
+			if (stop_words_.count(word) == 0) {
+				(is_minus ? minus_words : plus_words).emplace_back(word);
+			}
+		}
+		std::sort(plus_words.begin(), plus_words.end());
+		plus_words.erase(std::unique(plus_words.begin(), plus_words.end()), plus_words.end());
+
+		std::vector<double> inverse_document_freqs;
+		std::set<int> candidate_ids;
+		for (const std::string& word : plus_words) {
+			const std::set<int>& ids = GetDocumentsWith(word);
+			inverse_document_freqs.push_back(ids.empty() ? 0.0 : std::log(documents_.size() * 1.0 / ids.size()));
+			candidate_ids.insert(ids.begin(), ids.end());
+		}
+
+		std::vector<Document> matched_documents;
+		for (const int id : candidate_ids) {
+			const Entry& entry = documents_.at(id);
+			const auto contains = [&entry](const std::string& word) {
+				return entry.term_freqs.count(word) > 0;
+			};
+			if (std::any_of(minus_words.begin(), minus_words.end(), contains)
+				|| !document_predicate(id, entry.status, entry.rating)) {
+				continue;
+			}
+			double relevance = 0.0;
+			for (size_t i = 0; i < plus_words.size(); ++i) {
+				const auto it = entry.term_freqs.find(plus_words[i]);
+				if (it != entry.term_freqs.end()) {
+					relevance = relevance + it->second * inverse_document_freqs[i];
+				}
+			}
+			matched_documents.push_back({ id, relevance, entry.rating });
+		}
+		std::sort(matched_documents.begin(), matched_documents.end(), IsMoreRelevant);
+		if (matched_documents.size() > count) {
+			matched_documents.resize(count);
+		}
+		return matched_documents;
+	}
+
+private:
+	struct Entry {
+		DocumentStatus status;
+		int rating;
+		std::map<std::string, double, std::less<>> term_freqs;
+	};
+
+	std::set<std::string, std::less<>> stop_words_;
+	std::map<int, Entry> documents_;
+	std::map<std::string, std::set<int>, std::less<>> word_to_documents_;
+
+	const std::set<int>& GetDocumentsWith(const std::string& word) const {
+		static const std::set<int> NO_DOCUMENTS;
+		const auto it = word_to_documents_.find(word);
+		return it == word_to_documents_.end() ? NO_DOCUMENTS : it->second;
+	}
+};
+
+// Words with a skewed distribution, so that some postings are long and span
+// many pruning windows while most are short.
+class Corpus {
+public:
+	Corpus(std::mt19937& generator, size_t dictionary_size)
+		: generator_(generator) {
+		std::set<std::string> words;
+		std::uniform_int_distribution<int> length(2, 7);
+		std::uniform_int_distribution<int> letter('a', 'z');
+		while (words.size() < dictionary_size) {
+			std::string word(length(generator_), ' ');
+			for (char& c : word) {
+				c = static_cast<char>(letter(generator_));
+			}
+			words.insert(std::move(word));
+		}
+		dictionary_.assign(words.begin(), words.end());
+		std::shuffle(dictionary_.begin(), dictionary_.end(), generator_);
+	}
+
+	const std::string& GetWord() {
+		const double x = std::uniform_real_distribution<double>(0.0, 1.0)(generator_);
+		return dictionary_[static_cast<size_t>(x * x * x * dictionary_.size())];
+	}
+
+	std::string GetStopWords() const {
+		return dictionary_[0] + ' ' + dictionary_[5] + ' ' + dictionary_[40];
+	}
+
+	std::string GetDocument() {
+		std::string text = GetWord();
+		for (int i = std::uniform_int_distribution<int>(0, 30)(generator_); i > 0; --i) {
+			text += ' ';
+			text += GetWord();
+		}
+		return text;
+	}
+
+	std::string GetQuery() {
+		std::string text;
+		for (int i = std::uniform_int_distribution<int>(1, 12)(generator_); i > 0; --i) {
+			if (!text.empty()) {
+				text += ' ';
+			}
+			const int kind = std::uniform_int_distribution<int>(0, 19)(generator_);
+			if (kind < 3) {
+				text += '-';
+			}
+			text += kind == 19 ? "absentword"s : GetWord();
+		}
+		return text;
+	}
+
+	DocumentStatus GetStatus() {
+		const int kind = std::uniform_int_distribution<int>(0, 9)(generator_);
+		return kind < 7 ? DocumentStatus::ACTUAL : static_cast<DocumentStatus>(kind - 6);
+	}
+
+	std::vector<int> GetRatings() {
+		std::vector<int> ratings(std::uniform_int_distribution<size_t>(1, 3)(generator_));
+		for (int& rating : ratings) {
+			rating = std::uniform_int_distribution<int>(-5, 10)(generator_);
+		}
+		return ratings;
+	}
+
+private:
+	std::mt19937& generator_;
+	std::vector<std::string> dictionary_;
+};
+
+// the index together with the reference and the texts they were built from
+struct Fixture {
+	Fixture(std::mt19937& generator, Corpus& corpus)
+		: generator(generator), corpus(corpus), search_server(corpus.GetStopWords()),
+		reference(SplitStopWords(corpus.GetStopWords())) {
+	}
+
+	static std::set<std::string, std::less<>> SplitStopWords(std::string_view text) {
+		std::set<std::string, std::less<>> stop_words;
+		for (std::string_view word : SplitWords(text)) {
+			stop_words.emplace(word);
+		}
+		return stop_words;
+	}
+
+	void AddDocuments(int count) {
+		// half one by one, half as a batch
+		std::vector<NewDocument> batch;
+		for (int i = 0; i < count; ++i) {
+			const int id = next_id;
+			next_id += std::uniform_int_distribution<int>(1, 3)(generator);
+			texts[id] = corpus.GetDocument();
+			const DocumentStatus status = corpus.GetStatus();
+			const std::vector<int> ratings = corpus.GetRatings();
+			if (i < count / 2) {
+				search_server.AddDocument(id, texts[id], status, ratings);
+			}
+			else {
+				batch.push_back({ id, texts[id], status, ratings });
+			}
+			reference.AddDocument(id, texts[id], status, ratings);
+		}
+		search_server.AddDocuments(batch);
+	}
+
+	int GetRandomId() {
+		auto it = texts.begin();
+		std::advance(it, std::uniform_int_distribution<size_t>(0, texts.size() - 1)(generator));
+		return it->first;
+	}
+
+	void RemoveDocuments(int count) {
+		for (int i = 0; i < count; ++i) {
+			const int id = GetRandomId();
+			search_server.RemoveDocument(id);
+			reference.RemoveDocument(id);
+			texts.erase(id);
+		}
+	}
+
+	void UpdateDocuments(int count) {
+		for (int i = 0; i < count; ++i) {
+			const int id = GetRandomId();
+			// a third of the updates keep the text and only change the rating and status
+			if (std::uniform_int_distribution<int>(0, 2)(generator) > 0) {
+				texts[id] = corpus.GetDocument();
+			}
+			const DocumentStatus status = corpus.GetStatus();
+			const std::vector<int> ratings = corpus.GetRatings();
+			search_server.UpdateDocument(id, texts[id], status, ratings);
+			reference.AddDocument(id, texts[id], status, ratings);
+		}
+	}
+
+	std::mt19937& generator;
+	Corpus& corpus;
+	SearchServer search_server;
+	ReferenceIndex reference;
+	// texts outlive the views the index keeps
+	std::map<int, std::string> texts;
+	int next_id = 0;
+};
+
+const auto IS_ACTUAL = [](int, DocumentStatus status, int) {
+	return status == DocumentStatus::ACTUAL;
+};
+
+const auto IS_BANNED = [](int, DocumentStatus status, int) {
+	return status == DocumentStatus::BANNED;
+};
+
+// a predicate unrelated to the ranking, that drops documents from the middle of the postings
+const auto IS_SAMPLED = [](int document_id, DocumentStatus, int rating) {
+	return document_id % 3 != 0 && rating % 2 == 0;
+};
+
+const std::vector<std::pair<RankingMode, std::string>> RANKING_MODES = {
+	{ RankingMode::EXHAUSTIVE, "exhaustive"s },
+	{ RankingMode::DYNAMIC_PRUNING, "pruning"s },
+	{ RankingMode::IMPACT_ORDERED, "impact"s },
+};
+
+void CheckSearches(Fixture& fixture, const std::vector<std::string>& queries, const std::string& stage) {
+	SearchServer& search_server = fixture.search_server;
+	const size_t max_count = search_server.GetMaxResultDocumentCount();
+	std::vector<std::vector<Document>> expected_results;
+	for (const std::string& query : queries) {
+		const auto& expected_actual = expected_results.emplace_back(fixture.reference.FindTopDocuments(query, IS_ACTUAL, max_count));
+		const auto expected_banned = fixture.reference.FindTopDocuments(query, IS_BANNED, max_count);
+		const auto expected_even = fixture.reference.FindTopDocuments(query, IS_SAMPLED, 17);
+		const auto expected_all = fixture.reference.FindTopDocuments(query, IS_ACTUAL, 1000);
+		for (const auto& [mode, mode_name] : RANKING_MODES) {
+			search_server.SetRankingMode(mode);
+			const std::string what = stage + ", "s + mode_name + ", query \""s + query + "\""s;
+			CheckSame(search_server.FindTopDocuments(query), expected_actual, what + ", seq"s);
+			CheckSame(search_server.FindTopDocuments(std::execution::par, query), expected_actual, what + ", par"s);
+			CheckSame(search_server.FindTopDocuments(query, DocumentStatus::BANNED), expected_banned, what + ", banned"s);
+			CheckSame(search_server.FindTopDocuments(std::execution::par, query, DocumentStatus::BANNED), expected_banned,
+				what + ", banned par"s);
+			CheckSame(search_server.FindTopDocuments(query, IS_SAMPLED, 17), expected_even, what + ", predicate"s);
+			CheckSame(search_server.FindTopDocuments(std::execution::par, query, IS_SAMPLED, 17), expected_even,
+				what + ", predicate par"s);
+			CheckSame(search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, 1000), expected_all, what + ", all"s);
+			CheckSame(search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, SearchLimits{}).documents, expected_actual,
+				what + ", limits"s);
+		}
+	}
+
+	const std::vector<std::string_view> batch(queries.begin(), queries.end());
+	for (const auto& [mode, mode_name] : RANKING_MODES) {
+		search_server.SetRankingMode(mode);
+		const auto results = search_server.FindTopDocumentsBatch(batch);
+		Check(results.size() == queries.size(), stage + ", "s + mode_name + ", batch size"s);
+		for (size_t i = 0; i < std::min(results.size(), queries.size()); ++i) {
+			CheckSame(results[i], expected_results[i],
+				stage + ", "s + mode_name + ", batch query \""s + queries[i] + "\""s);
+		}
+	}
+	search_server.SetRankingMode(RankingMode::EXHAUSTIVE);
+
+	const auto joined = ProcessQueriesJoined(search_server, queries);
+	std::vector<Document> expected_joined;
+	for (const auto& documents : expected_results) {
+		expected_joined.insert(expected_joined.end(), documents.begin(), documents.end());
+	}
+	CheckSame(joined, expected_joined, stage + ", ProcessQueriesJoined"s);
+}
+
+void CheckDocumentIds(const Fixture& fixture, const std::string& stage) {
+	const SearchServer& search_server = fixture.search_server;
+	const std::vector<int> expected = fixture.reference.GetDocumentIds();
+	Check(search_server.GetDocumentCount() == static_cast<int>(expected.size()), stage + ", GetDocumentCount"s);
+
+	// GetDocumentId walks the live documents in the order of the iteration
+	std::vector<int> iterated(search_server.begin(), search_server.end());
+	bool is_same = iterated.size() == expected.size();
+	for (int index = 0; is_same && index < static_cast<int>(iterated.size()); ++index) {
+		is_same = search_server.GetDocumentId(index) == iterated[index];
+	}
+	Check(is_same, stage + ", GetDocumentId follows the iteration"s);
+	std::sort(iterated.begin(), iterated.end());
+	Check(iterated == expected, stage + ", live document ids"s);
+
+	bool is_thrown = false;
+	try {
+		search_server.GetDocumentId(search_server.GetDocumentCount());
+	}
+	catch (const std::out_of_range&) {
+		is_thrown = true;
+	}
+	Check(is_thrown, stage + ", GetDocumentId past the end throws"s);
+}
+
+void CheckSnapshot(const Fixture& fixture, const std::vector<std::string>& queries, const std::string& stage) {
+	const std::string path = (std::filesystem::temp_directory_path()
+		/ ("search_server_test_"s + std::to_string(std::random_device{}()) + ".snapshot"s)).string();
+	fixture.search_server.SaveSnapshot(path);
+	{
+		const MappedSearchServer mapped_server(path);
+		Check(mapped_server.GetDocumentCount() == fixture.search_server.GetDocumentCount(), stage + ", snapshot document count"s);
+		bool is_verified = true;
+		try {
+			mapped_server.Verify();
+		}
+		catch (const std::runtime_error&) {
+			is_verified = false;
+		}
+		Check(is_verified, stage + ", snapshot verifies"s);
+		const size_t max_count = mapped_server.GetMaxResultDocumentCount();
+		for (const std::string& query : queries) {
+			const std::string what = stage + ", snapshot, query \""s + query + "\""s;
+			CheckSame(mapped_server.FindTopDocuments(query), fixture.reference.FindTopDocuments(query, IS_ACTUAL, max_count), what);
+			CheckSame(mapped_server.FindTopDocuments(query, IS_SAMPLED, 17),
+				fixture.reference.FindTopDocuments(query, IS_SAMPLED, 17), what + ", predicate"s);
+		}
+		for (const auto& [id, text] : fixture.texts) {
+			if (mapped_server.GetDocumentText(id) != text) {
+				Check(false, stage + ", snapshot text of document "s + std::to_string(id));
+				break;
+			}
+		}
+	}
+	std::filesystem::remove(path);
+}
+
+void CheckCache(Fixture& fixture, const std::vector<std::string>& queries) {
+	const size_t max_count = fixture.search_server.GetMaxResultDocumentCount();
+	// small enough to evict entries
+	QueryResultCache cache(fixture.search_server, 4096);
+	for (int round = 0; round < 3; ++round) {
+		for (const std::string& query : queries) {
+			const std::string what = "cache round "s + std::to_string(round) + ", query \""s + query + "\""s;
+			const auto expected = fixture.reference.FindTopDocuments(query, IS_ACTUAL, max_count);
+			CheckSame(cache.FindTopDocuments(query), expected, what);
+			CheckSame(cache.FindTopDocuments(query, "sampled"sv, [](int document_id, DocumentStatus status, int rating) {
+				return IS_SAMPLED(document_id, status, rating);
+				}), fixture.reference.FindTopDocuments(query, IS_SAMPLED, max_count), what + ", predicate"s);
+			// the same words in another order and repeated share the entry
+			std::vector<std::string_view> words = SplitWords(query);
+			std::reverse(words.begin(), words.end());
+			std::string reordered;
+			for (std::string_view word : words) {
+				reordered += std::string(word) + ' ' + std::string(word) + ' ';
+			}
+			reordered.pop_back();
+			CheckSame(cache.FindTopDocuments(reordered), expected, what + ", reordered"s);
+		}
+		// every change of the server drops the cached results
+		fixture.RemoveDocuments(50);
+		fixture.UpdateDocuments(50);
+		fixture.AddDocuments(50);
+	}
+	Check(cache.GetStats().hits > 0, "cache hits"s);
+	Check(cache.GetStats().invalidations > 0, "cache invalidations"s);
+}
+
+void CheckConcurrent(std::mt19937& generator, Corpus& corpus, const std::vector<std::string>& queries) {
+	ConcurrentSearchServer concurrent_server(corpus.GetStopWords());
+	ReferenceIndex reference(Fixture::SplitStopWords(corpus.GetStopWords()));
+	std::map<int, std::string> texts;
+	for (int id = 0; id < 3000; ++id) {
+		texts[id] = corpus.GetDocument();
+		const DocumentStatus status = corpus.GetStatus();
+		const std::vector<int> ratings = corpus.GetRatings();
+		concurrent_server.AddDocument(id, texts[id], status, ratings);
+		reference.AddDocument(id, texts[id], status, ratings);
+	}
+
+	// readers search while a writer removes and updates documents: every result has
+	// to come ranked from one consistent state of the index
+	std::atomic<bool> is_writing = true;
+	std::atomic<size_t> reader_failures = 0;
+	std::vector<std::thread> readers;
+	for (size_t i = 0; i < 2; ++i) {
+		readers.emplace_back([&, i] {
+			for (size_t query_index = i; is_writing; ++query_index) {
+				try {
+					const auto documents = concurrent_server.FindTopDocuments(queries[query_index % queries.size()]);
+					if (documents.size() > MAX_RESULT_DOCUMENT_COUNT
+						|| !std::is_sorted(documents.begin(), documents.end(), IsMoreRelevant)) {
+						++reader_failures;
+					}
+				}
+				catch (...) {
+					++reader_failures;
+				}
+			}
+			});
+	}
+	for (int i = 0; i < 200; ++i) {
+		const int id = std::uniform_int_distribution<int>(0, 2999)(generator);
+		if (texts.count(id) == 0) {
+			continue;
+		}
+		if (i % 2 == 0) {
+			concurrent_server.RemoveDocument(id);
+			reference.RemoveDocument(id);
+			texts.erase(id);
+		}
+		else {
+			texts[id] = corpus.GetDocument();
+			const DocumentStatus status = corpus.GetStatus();
+			const std::vector<int> ratings = corpus.GetRatings();
+			concurrent_server.UpdateDocument(id, texts[id], status, ratings);
+			reference.AddDocument(id, texts[id], status, ratings);
+		}
+	}
+	is_writing = false;
+	for (std::thread& reader : readers) {
+		reader.join();
+	}
+	Check(reader_failures == 0, "concurrent readers during writes"s);
+	Check(concurrent_server.GetDocumentCount() == static_cast<int>(texts.size()), "concurrent document count"s);
+
+	// once the writes are done, every mode against the reference from several threads at once
+	std::vector<std::vector<Document>> expected_results;
+	for (const std::string& query : queries) {
+		expected_results.push_back(reference.FindTopDocuments(query, IS_SAMPLED, MAX_RESULT_DOCUMENT_COUNT));
+	}
+	for (const auto& [mode, mode_name] : RANKING_MODES) {
+		concurrent_server.SetRankingMode(mode);
+		std::atomic<size_t> mismatches = 0;
+		std::vector<std::thread> searchers;
+		for (int i = 0; i < 4; ++i) {
+			searchers.emplace_back([&] {
+				for (size_t i = 0; i < queries.size(); ++i) {
+					if (!AreSame(concurrent_server.FindTopDocuments(queries[i], IS_SAMPLED), expected_results[i])) {
+						++mismatches;
+					}
+					// the SearchLimits overloads pass through with their own result type
+					const SearchResult result = concurrent_server.FindTopDocuments(queries[i], IS_SAMPLED, SearchLimits{});
+					if (!AreSame(result.documents, expected_results[i])) {
+						++mismatches;
+					}
+				}
+				});
+		}
+		for (std::thread& searcher : searchers) {
+			searcher.join();
+		}
+		Check(mismatches == 0, "concurrent searches, "s + mode_name);
+	}
+}
+
+void CheckInvalidQueries(Fixture& fixture) {
+	const std::vector<std::string> invalid_queries = {
+		"cat --dog"s,
+		"cat -"s,
+		"cat dog "s,
+		"c\x01t dog"s,
+		"-"s,
+	};
+	for (const auto& [mode, mode_name] : RANKING_MODES) {
+		fixture.search_server.SetRankingMode(mode);
+		for (const std::string& query : invalid_queries) {
+			const auto throws = [](const auto& search) {
+				try {
+					search();
+				}
+				catch (const std::invalid_argument&) {
+					return true;
+				}
+				return false;
+			};
+			const std::string what = mode_name + ", invalid query \""s + query + "\" throws"s;
+			Check(throws([&] { fixture.search_server.FindTopDocuments(query); }), what);
+			Check(throws([&] { fixture.search_server.FindTopDocuments(std::execution::par, query); }), what + ", par"s);
+			Check(throws([&] { fixture.search_server.FindTopDocumentsBatch({ "cat"sv, query, "dog"sv }); }), what + ", batch"s);
+		}
+	}
+	fixture.search_server.SetRankingMode(RankingMode::EXHAUSTIVE);
+}
+
+void CheckRankingOrder(std::mt19937& generator) {
+	// relevances clustered around bucket boundaries, where a tolerance would not be transitive
+	std::vector<Document> documents;
+	for (int id = 0; id < 120; ++id) {
+		const double relevance = std::uniform_int_distribution<int>(0, 3)(generator) * ERROR_COMPARSION
+			+ std::uniform_int_distribution<int>(-2, 2)(generator) * ERROR_COMPARSION / 4;
+		documents.push_back({ id, relevance, std::uniform_int_distribution<int>(0, 2)(generator) });
+	}
+	bool is_strict = true;
+	for (const Document& a : documents) {
+		is_strict = is_strict && !IsMoreRelevant(a, a);
+		for (const Document& b : documents) {
+			if (a.id != b.id) {
+				is_strict = is_strict && (IsMoreRelevant(a, b) != IsMoreRelevant(b, a));
+			}
+			for (const Document& c : documents) {
+				if (IsMoreRelevant(a, b) && IsMoreRelevant(b, c)) {
+					is_strict = is_strict && IsMoreRelevant(a, c);
+				}
+			}
+		}
+	}
+	Check(is_strict, "IsMoreRelevant is a strict total order"s);
+}
+
+std::vector<std::string> MakeQueries(Corpus& corpus) {
+	std::vector<std::string> queries;
+	for (int i = 0; i < QUERY_COUNT; ++i) {
+		queries.push_back(corpus.GetQuery());
+	}
+	return queries;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+	const uint32_t seed = argc > 1 ? static_cast<uint32_t>(std::stoul(argv[1])) : DEFAULT_SEED;
+	std::cout << "seed "s << seed << std::endl;
+	std::mt19937 generator(seed);
+	Corpus corpus(generator, 400);
+
+	CheckRankingOrder(generator);
+
+	Fixture fixture(generator, corpus);
+	const std::vector<std::string> queries = MakeQueries(corpus);
+
+	fixture.AddDocuments(DOCUMENT_COUNT);
+	CheckDocumentIds(fixture, "segmented"s);
+	CheckSearches(fixture, queries, "segmented"s);
+
+	fixture.RemoveDocuments(DOCUMENT_COUNT / 10);
+	fixture.UpdateDocuments(DOCUMENT_COUNT / 10);
+	CheckDocumentIds(fixture, "segmented with removals"s);
+	CheckSearches(fixture, queries, "segmented with removals"s);
+	CheckSnapshot(fixture, queries, "segmented with removals"s);
+
+	fixture.search_server.CompressPostings();
+	Check(fixture.search_server.IsCompressed(), "compressed"s);
+	CheckDocumentIds(fixture, "compressed"s);
+	CheckSearches(fixture, queries, "compressed"s);
+
+	fixture.AddDocuments(DOCUMENT_COUNT / 4);
+	fixture.RemoveDocuments(DOCUMENT_COUNT / 20);
+	fixture.UpdateDocuments(DOCUMENT_COUNT / 20);
+	fixture.search_server.FreezeTerms();
+	CheckDocumentIds(fixture, "compressed with a tail"s);
+	CheckSearches(fixture, MakeQueries(corpus), "compressed with a tail"s);
+	CheckSnapshot(fixture, queries, "compressed with a tail"s);
+
+	CheckCache(fixture, queries);
+	CheckInvalidQueries(fixture);
+	CheckConcurrent(generator, corpus, queries);
+
+	std::cout << check_count << " checks, "s << failure_count << " failed"s << std::endl;
+	return failure_count == 0 ? 0 : 1;
+}
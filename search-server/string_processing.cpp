@@ -1,19 +1,89 @@
 #include "string_processing.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define STRING_PROCESSING_SSE2
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
 
-std::vector<std::string_view> SplitIntoWords(std::string_view str) {
-    std::vector<std::string_view> result;
-    int64_t pos = 0;
-    const int64_t pos_end = str.npos;
-    while (true) {
-        int64_t space = str.find(' ', pos);
-        result.push_back(space == pos_end ? str.substr(pos) : str.substr(pos, space - pos));
-        if (space == pos_end) {
-            break;
+namespace {
+#ifdef STRING_PROCESSING_SSE2
+    int CountTrailingZeros(unsigned mask) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return static_cast<int>(index);
+#else
+        return __builtin_ctz(mask);
+#endif
+    }
+#endif
+
+    bool IsControlCharacter(char c) {
+        return c >= '\0' && c < ' ';
+    }
+
+    // end of the word that starts at first: the next space or the end of the text
+    size_t ScanWord(std::string_view text, size_t first, bool& is_valid) {
+        size_t position = first;
+        bool has_control = false;
+#ifdef STRING_PROCESSING_SSE2
+        const __m128i spaces = _mm_set1_epi8(' ');
+        const __m128i minus_one = _mm_set1_epi8(-1);
+        for (; position + 16 <= text.size(); position += 16) {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + position));
+            const unsigned space_mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, spaces));
+            // bytes 0-31 as signed chars, so the bytes of UTF-8 sequences pass
+            const unsigned control_mask = _mm_movemask_epi8(
+                _mm_and_si128(_mm_cmplt_epi8(chunk, spaces), _mm_cmpgt_epi8(chunk, minus_one)));
+            if (space_mask != 0) {
+                const int offset = CountTrailingZeros(space_mask);
+                has_control = has_control || (control_mask & ((1u << offset) - 1)) != 0;
+                is_valid = !has_control;
+                return position + offset;
+            }
+            has_control = has_control || control_mask != 0;
         }
-        else {
-            pos = space + 1;
+#endif
+        for (; position < text.size() && text[position] != ' '; ++position) {
+            has_control = has_control || IsControlCharacter(text[position]);
         }
+        is_valid = !has_control;
+        return position;
     }
+}
+
+std::vector<std::string_view> SplitIntoWords(std::string_view str) {
+    std::vector<std::string_view> result;
+    ForEachWord(str, [&result](std::string_view word, bool) {
+        result.push_back(word);
+    });
     return result;
-}
\ No newline at end of file
+}
+
+bool IsValidWord(std::string_view word) {
+    bool is_valid = true;
+    size_t position = 0;
+    // a space only ends a scan, it is not a control character
+    while (is_valid && position < word.size()) {
+        position = ScanWord(word, position, is_valid) + 1;
+    }
+    return is_valid;
+}
+
+WordTokenizer::WordTokenizer(std::string_view text)
+    : text_(text) {
+}
+
+bool WordTokenizer::Next(Word& word) {
+    // position_ passes the end of the text after the last word
+    if (position_ > text_.size()) {
+        return false;
+    }
+    const size_t last = ScanWord(text_, position_, word.is_valid);
+    word.text = text_.substr(position_, last - position_);
+    position_ = last + 1;
+    return true;
+}
@@ -2,12 +2,47 @@
 
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <set>
 
 
 std::vector<std::string_view> SplitIntoWords(std::string_view str);
 
+// true when the word holds no control characters
+bool IsValidWord(std::string_view word);
+
+// Splits text by single spaces and validates the words in the same pass, SSE2 finds
+// the spaces and control characters of 16 bytes at once. Words come in order and, as
+// in SplitIntoWords, adjacent spaces give empty words. Nothing is allocated.
+class WordTokenizer {
+public:
+	struct Word {
+		std::string_view text;
+		// false when the word holds a control character
+		bool is_valid;
+	};
+
+	explicit WordTokenizer(std::string_view text);
+
+	// false once every word was read
+	bool Next(Word& word);
+
+private:
+	std::string_view text_;
+	size_t position_ = 0;
+};
+
+// calls function(word, is_valid) for every word of text
+template <typename Function>
+void ForEachWord(std::string_view text, Function function) {
+	WordTokenizer tokenizer(text);
+	WordTokenizer::Word word;
+	while (tokenizer.Next(word)) {
+		function(word.text, word.is_valid);
+	}
+}
+
 
 template<typename StringContainer>
 std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
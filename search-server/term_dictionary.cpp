@@ -0,0 +1,77 @@
+#include "term_dictionary.h"
+
+TermDictionary::TermDictionary(const TermDictionary& other) {
+	// the copied views would point into the other dictionary's arena
+	terms_.reserve(other.terms_.size());
+	term_ids_.reserve(other.terms_.size());
+	for (std::string_view term : other.terms_) {
+		Intern(term);
+	}
+	if (!other.frozen_term_ids_.empty()) {
+		Freeze();
+	}
+}
+
+TermDictionary& TermDictionary::operator=(const TermDictionary& other) {
+	if (this != &other) {
+		*this = TermDictionary(other);
+	}
+	return *this;
+}
+
+TermId TermDictionary::Intern(std::string_view word) {
+	const TermId frozen_term_id = FindFrozen(word);
+	if (frozen_term_id != NO_TERM) {
+		return frozen_term_id;
+	}
+	const auto it = term_ids_.find(word);
+	if (it != term_ids_.end()) {
+		return it->second;
+	}
+	const TermId term_id = static_cast<TermId>(terms_.size());
+	terms_.push_back(words_.Add(word));
+	term_ids_.emplace(terms_.back(), term_id);
+	return term_id;
+}
+
+TermId TermDictionary::Find(std::string_view word) const {
+	const TermId frozen_term_id = FindFrozen(word);
+	if (frozen_term_id != NO_TERM || term_ids_.empty()) {
+		return frozen_term_id;
+	}
+	const auto it = term_ids_.find(word);
+	return it == term_ids_.end() ? NO_TERM : it->second;
+}
+
+void TermDictionary::Freeze() {
+	frozen_hash_ = PerfectHash(terms_);
+	frozen_term_ids_.assign(terms_.size(), NO_TERM);
+	for (TermId term_id = 0; term_id < terms_.size(); ++term_id) {
+		frozen_term_ids_[frozen_hash_.GetSlot(terms_[term_id])] = term_id;
+	}
+	term_ids_ = {};
+}
+
+std::string_view TermDictionary::GetTerm(TermId term_id) const {
+	return terms_.at(term_id);
+}
+
+size_t TermDictionary::size() const {
+	return terms_.size();
+}
+
+size_t TermDictionary::GetMemoryUsage() const {
+	// nodes of the index with their cached hashes, and its buckets
+	return words_.GetMemoryUsage() + terms_.capacity() * sizeof(std::string_view)
+		+ term_ids_.size() * (sizeof(std::pair<const std::string_view, TermId>) + 2 * sizeof(void*))
+		+ term_ids_.bucket_count() * sizeof(void*)
+		+ frozen_hash_.GetMemoryUsage() + frozen_term_ids_.capacity() * sizeof(TermId);
+}
+
+TermId TermDictionary::FindFrozen(std::string_view word) const {
+	if (frozen_term_ids_.empty()) {
+		return NO_TERM;
+	}
+	const TermId term_id = frozen_term_ids_[frozen_hash_.GetSlot(word)];
+	return terms_[term_id] == word ? term_id : NO_TERM;
+}
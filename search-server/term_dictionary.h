@@ -0,0 +1,55 @@
+#pragma once
+
+#include "perfect_hash.h"
+#include "text_arena.h"
+
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using TermId = uint32_t;
+
+// Interns words to dense 32-bit ids. The dictionary owns the spelling of every
+// word in its arena, so string_views handed out by GetTerm stay valid for its lifetime.
+// A read-mostly dictionary can be frozen: the words it has by then move to a perfect
+// hash, and only words interned later stay in the hash map.
+class TermDictionary {
+public:
+	static constexpr TermId NO_TERM = std::numeric_limits<TermId>::max();
+
+	TermDictionary() = default;
+
+	TermDictionary(const TermDictionary& other);
+
+	TermDictionary& operator=(const TermDictionary& other);
+
+	TermDictionary(TermDictionary&&) = default;
+
+	TermDictionary& operator=(TermDictionary&&) = default;
+
+	TermId Intern(std::string_view word);
+
+	TermId Find(std::string_view word) const;
+
+	// lookups of the words interned so far become one hash and one compare
+	void Freeze();
+
+	std::string_view GetTerm(TermId term_id) const;
+
+	size_t size() const;
+
+	size_t GetMemoryUsage() const;
+
+private:
+	TextArena words_;
+	std::vector<std::string_view> terms_;
+	// ids of the words interned since the last Freeze
+	std::unordered_map<std::string_view, TermId> term_ids_;
+	PerfectHash frozen_hash_;
+	// term of every slot of frozen_hash_
+	std::vector<TermId> frozen_term_ids_;
+
+	TermId FindFrozen(std::string_view word) const;
+};
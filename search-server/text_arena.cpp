@@ -0,0 +1,107 @@
+#include "text_arena.h"
+
+#include <algorithm>
+#include <cstring>
+
+std::string_view TextArena::Add(std::string_view text) {
+	if (text.empty()) {
+		return {};
+	}
+	if (text.size() > free_size_) {
+		// the tail of the last chunk is left unused; long strings get a chunk of their own size
+		const size_t chunk_size = std::max(CHUNK_SIZE, text.size());
+		chunks_.push_back({ std::make_unique<char[]>(chunk_size), chunk_size });
+		free_size_ = chunk_size;
+		allocated_bytes_ += chunk_size;
+	}
+	Chunk& chunk = chunks_.back();
+	char* data = chunk.data.get() + (chunk.size - free_size_);
+	std::memcpy(data, text.data(), text.size());
+	free_size_ -= text.size();
+	used_bytes_ += text.size();
+	return { data, text.size() };
+}
+
+size_t TextArena::GetUsedBytes() const {
+	return used_bytes_;
+}
+
+size_t TextArena::GetMemoryUsage() const {
+	return allocated_bytes_ + chunks_.capacity() * sizeof(Chunk);
+}
+
+TextTable::TextTable(const TextTable& other)
+	: live_bytes_(other.live_bytes_) {
+	// the views must point into the new arena, the copy comes out compacted
+	texts_.reserve(other.texts_.size());
+	for (std::string_view text : other.texts_) {
+		texts_.push_back(arena_.Add(text));
+	}
+}
+
+TextTable& TextTable::operator=(const TextTable& other) {
+	if (this != &other) {
+		*this = TextTable(other);
+	}
+	return *this;
+}
+
+void TextTable::PushBack(std::string_view text) {
+	texts_.push_back(arena_.Add(text));
+	live_bytes_ += text.size();
+}
+
+void TextTable::Set(size_t index, std::string_view text) {
+	Drop(index);
+	texts_[index] = arena_.Add(text);
+	live_bytes_ += text.size();
+	MaybeCompact();
+}
+
+void TextTable::Clear(size_t index) {
+	Drop(index);
+	MaybeCompact();
+}
+
+void TextTable::Move(size_t from, size_t to) {
+	Drop(to);
+	texts_[to] = texts_[from];
+	texts_[from] = {};
+}
+
+void TextTable::Truncate(size_t new_size) {
+	while (texts_.size() > new_size) {
+		Drop(texts_.size() - 1);
+		texts_.pop_back();
+	}
+	MaybeCompact();
+}
+
+void TextTable::Reserve(size_t capacity) {
+	texts_.reserve(capacity);
+}
+
+size_t TextTable::size() const {
+	return texts_.size();
+}
+
+size_t TextTable::GetMemoryUsage() const {
+	return arena_.GetMemoryUsage() + texts_.capacity() * sizeof(std::string_view);
+}
+
+void TextTable::Drop(size_t index) {
+	live_bytes_ -= texts_[index].size();
+	texts_[index] = {};
+}
+
+void TextTable::MaybeCompact() {
+	const size_t dead_bytes = arena_.GetUsedBytes() - live_bytes_;
+	if (dead_bytes <= live_bytes_ || dead_bytes < TextArena::CHUNK_SIZE) {
+		return;
+	}
+	TextArena arena;
+	for (std::string_view& text : texts_) {
+		text = arena.Add(text);
+	}
+	arena_ = std::move(arena);
+}
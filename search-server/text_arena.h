@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Append-only storage for strings: they are copied back to back into large chunks
+// instead of a heap block each. Strings never move, so views of them stay valid for
+// the lifetime of the arena.
+class TextArena {
+public:
+	static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+	TextArena() = default;
+
+	TextArena(const TextArena&) = delete;
+
+	TextArena& operator=(const TextArena&) = delete;
+
+	TextArena(TextArena&&) = default;
+
+	TextArena& operator=(TextArena&&) = default;
+
+	std::string_view Add(std::string_view text);
+
+	// bytes taken by the strings
+	size_t GetUsedBytes() const;
+
+	size_t GetMemoryUsage() const;
+
+private:
+	struct Chunk {
+		std::unique_ptr<char[]> data;
+		size_t size;
+	};
+
+	std::vector<Chunk> chunks_;
+	// free space at the end of the last chunk
+	size_t free_size_ = 0;
+	size_t used_bytes_ = 0;
+	size_t allocated_bytes_ = 0;
+};
+
+// Strings by index, kept in a TextArena. Replaced and cleared strings stay in the arena
+// as dead bytes; once they outweigh the live ones the live strings are copied to a fresh
+// arena, so views returned by operator[] are only valid until the next change.
+class TextTable {
+public:
+	TextTable() = default;
+
+	TextTable(const TextTable& other);
+
+	TextTable& operator=(const TextTable& other);
+
+	TextTable(TextTable&&) = default;
+
+	TextTable& operator=(TextTable&&) = default;
+
+	void PushBack(std::string_view text);
+
+	void Set(size_t index, std::string_view text);
+
+	void Clear(size_t index);
+
+	// moves the string of from to to, leaving from empty and dropping the string of to
+	void Move(size_t from, size_t to);
+
+	// drops the strings from new_size on
+	void Truncate(size_t new_size);
+
+	void Reserve(size_t capacity);
+
+	std::string_view operator[](size_t index) const {
+		return texts_[index];
+	}
+
+	size_t size() const;
+
+	size_t GetMemoryUsage() const;
+
+private:
+	TextArena arena_;
+	std::vector<std::string_view> texts_;
+	size_t live_bytes_ = 0;
+
+	void Drop(size_t index);
+
+	// copies the live strings to a fresh arena when the dead ones outweigh them
+	void MaybeCompact();
+};
@@ -0,0 +1,100 @@
+#include "thread_pool.h"
+
+namespace {
+
+// the pool and the worker the current thread runs for, if any
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local size_t current_worker = 0;
+
+}  // namespace
+
+ThreadPool::ThreadPool(size_t thread_count) {
+	thread_count = std::max<size_t>(thread_count, 1);
+	for (size_t i = 0; i < thread_count; ++i) {
+		workers_.push_back(std::make_unique<Worker>());
+	}
+	threads_.reserve(thread_count);
+	for (size_t i = 0; i < thread_count; ++i) {
+		threads_.emplace_back([this, i] {
+			Run(i);
+		});
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard guard(mutex_);
+		is_stopping_ = true;
+	}
+	task_added_.notify_all();
+	for (std::thread& thread : threads_) {
+		thread.join();
+	}
+}
+
+size_t ThreadPool::GetThreadCount() const {
+	return threads_.size();
+}
+
+void ThreadPool::Push(Task task) {
+	size_t worker_index = current_worker;
+	if (current_pool != this) {
+		std::lock_guard guard(mutex_);
+		worker_index = next_worker_;
+		next_worker_ = (next_worker_ + 1) % workers_.size();
+	}
+	{
+		Worker& worker = *workers_[worker_index];
+		std::lock_guard guard(worker.mutex);
+		worker.tasks.push_back(std::move(task));
+	}
+	{
+		std::lock_guard guard(mutex_);
+		++unclaimed_count_;
+	}
+	task_added_.notify_one();
+}
+
+void ThreadPool::Run(size_t worker_index) {
+	current_pool = this;
+	current_worker = worker_index;
+	while (true) {
+		{
+			std::unique_lock lock(mutex_);
+			task_added_.wait(lock, [this] {
+				return unclaimed_count_ > 0 || is_stopping_;
+			});
+			if (unclaimed_count_ == 0) {
+				return;
+			}
+			--unclaimed_count_;
+		}
+		Take(worker_index)();
+	}
+}
+
+ThreadPool::Task ThreadPool::Take(size_t worker_index) {
+	// every claim matches a task already in some deque, so the search ends; a pass can
+	// still come up empty while other workers take the tasks it looked at
+	while (true) {
+		{
+			Worker& worker = *workers_[worker_index];
+			std::lock_guard guard(worker.mutex);
+			if (!worker.tasks.empty()) {
+				Task task = std::move(worker.tasks.back());
+				worker.tasks.pop_back();
+				return task;
+			}
+		}
+		for (size_t i = 1; i < workers_.size(); ++i) {
+			Worker& victim = *workers_[(worker_index + i) % workers_.size()];
+			std::lock_guard guard(victim.mutex);
+			if (!victim.tasks.empty()) {
+				Task task = std::move(victim.tasks.front());
+				victim.tasks.pop_front();
+				return task;
+			}
+		}
+		std::this_thread::yield();
+	}
+}
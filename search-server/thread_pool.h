@@ -0,0 +1,72 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Fixed set of worker threads with a task deque each. Tasks submitted from outside go
+// to the deques in turn, tasks submitted by a running task go to the deque of its own
+// worker. A worker takes the newest task of its deque and, when that is empty, steals
+// the oldest task of another one, so bursts spread over every worker. A task must not
+// block on tasks it submitted: every worker could end up waiting.
+class ThreadPool {
+public:
+	explicit ThreadPool(size_t thread_count = std::max(1u, std::thread::hardware_concurrency()));
+
+	ThreadPool(const ThreadPool&) = delete;
+
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// runs the tasks submitted so far, then joins the workers
+	~ThreadPool();
+
+	// the future holds the result of function or its exception
+	template <typename Function>
+	std::future<std::invoke_result_t<Function>> Submit(Function function);
+
+	size_t GetThreadCount() const;
+
+private:
+	using Task = std::function<void()>;
+
+	struct Worker {
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	std::vector<std::unique_ptr<Worker>> workers_;
+	std::vector<std::thread> threads_;
+	std::mutex mutex_;
+	std::condition_variable task_added_;
+	// tasks in the deques that no worker has claimed yet
+	size_t unclaimed_count_ = 0;
+	size_t next_worker_ = 0;
+	bool is_stopping_ = false;
+
+	void Push(Task task);
+
+	void Run(size_t worker_index);
+
+	// own deque first, then the others; a worker only looks after claiming a task
+	Task Take(size_t worker_index);
+};
+
+template <typename Function>
+std::future<std::invoke_result_t<Function>> ThreadPool::Submit(Function function) {
+	// std::function needs a copyable target, the task itself is move-only
+	auto task = std::make_shared<std::packaged_task<std::invoke_result_t<Function>()>>(std::move(function));
+	auto result = task->get_future();
+	Push([task] {
+		(*task)();
+	});
+	return result;
+}
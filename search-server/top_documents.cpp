@@ -0,0 +1,58 @@
+#include "top_documents.h"
+
+#include <cmath>
+
+bool IsMoreRelevant(const Document& lhs, const Document& rhs) {
+	const double lhs_bucket = std::floor(lhs.relevance / ERROR_COMPARSION);
+	const double rhs_bucket = std::floor(rhs.relevance / ERROR_COMPARSION);
+	if (lhs_bucket != rhs_bucket) {
+		return lhs_bucket > rhs_bucket;
+	}
+	if (lhs.rating != rhs.rating) {
+		return lhs.rating > rhs.rating;
+	}
+	return lhs.id < rhs.id;
+}
+
+TopDocuments::TopDocuments(size_t capacity)
+	: capacity_(capacity) {
+	heap_.reserve(std::min<size_t>(capacity, 1024));
+}
+
+bool TopDocuments::Push(const Document& document) {
+	if (heap_.size() < capacity_) {
+		heap_.push_back(document);
+		std::push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+		return true;
+	}
+	if (capacity_ == 0 || !IsMoreRelevant(document, heap_.front())) {
+		return false;
+	}
+	std::pop_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+	heap_.back() = document;
+	std::push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+	return true;
+}
+
+void TopDocuments::Merge(const TopDocuments& other) {
+	for (const Document& document : other.heap_) {
+		Push(document);
+	}
+}
+
+bool TopDocuments::IsFull() const {
+	return heap_.size() == capacity_;
+}
+
+const Document& TopDocuments::GetWorst() const {
+	return heap_.front();
+}
+
+size_t TopDocuments::GetCapacity() const {
+	return capacity_;
+}
+
+std::vector<Document> TopDocuments::Extract() {
+	std::sort_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+	return std::move(heap_);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "document.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <execution>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+const double ERROR_COMPARSION = 1e-6;
+
+// Ranking order of search results: relevances are compared in buckets of
+// ERROR_COMPARSION, higher bucket first, then higher rating, then ascending id.
+// Unlike a comparison with a tolerance this is a strict total order, as the heap
+// and the sorts need: two relevances closer than ERROR_COMPARSION are ordered by
+// rating only when they fall into the same bucket.
+bool IsMoreRelevant(const Document& lhs, const Document& rhs);
+
+// Bounded collection of the best documents seen so far, kept as a heap with
+// the least relevant of them on top.
+class TopDocuments {
+public:
+	explicit TopDocuments(size_t capacity);
+
+	bool Push(const Document& document);
+
+	void Merge(const TopDocuments& other);
+
+	bool IsFull() const;
+
+	// the document a candidate has to beat once the collection is full
+	const Document& GetWorst() const;
+
+	size_t GetCapacity() const;
+
+	std::vector<Document> Extract();
+
+private:
+	size_t capacity_;
+	std::vector<Document> heap_;
+};
+
+template <typename ExecutionPolicy>
+std::vector<Document> SelectTopDocuments(ExecutionPolicy&& policy, const std::vector<Document>& documents, size_t count) {
+	if constexpr (std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>) {
+		TopDocuments top_documents(count);
+		for (const Document& document : documents) {
+			top_documents.Push(document);
+		}
+		return top_documents.Extract();
+	}
+	else {
+		// every chunk keeps its own heap, the heaps are merged once all chunks are done
+		const size_t chunk_count = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), documents.size() / 1024));
+		const size_t chunk_size = (documents.size() + chunk_count - 1) / chunk_count;
+		std::vector<TopDocuments> chunk_tops(chunk_count, TopDocuments(count));
+		std::vector<size_t> chunk_indexes(chunk_count);
+		for (size_t i = 0; i < chunk_count; ++i) {
+			chunk_indexes[i] = i;
+		}
+		std::for_each(policy, chunk_indexes.begin(), chunk_indexes.end(),
+			[&documents, &chunk_tops, chunk_size](size_t chunk_index) {
+				const size_t first = std::min(chunk_index * chunk_size, documents.size());
+				const size_t last = std::min(first + chunk_size, documents.size());
+				for (size_t i = first; i < last; ++i) {
+					chunk_tops[chunk_index].Push(documents[i]);
+				}
+			});
+		for (size_t i = 1; i < chunk_count; ++i) {
+			chunk_tops[0].Merge(chunk_tops[i]);
+		}
+		return chunk_tops[0].Extract();
+	}
+}